@@ -0,0 +1,310 @@
+#ifndef ALPHA_CAPTURE_H
+#define ALPHA_CAPTURE_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+// Source d'overlay avec canal alpha, décodée directement en BGRA.
+//
+// cv::VideoCapture ne renvoie que du BGR : la transparence d'un overlay n'était
+// possible que par chroma key. AlphaCapture expose la même interface minimale
+// (open / get / grab / read / set) et lit :
+//   - les séquences d'images ("anim_%04d.png") et images fixes via
+//     imread(IMREAD_UNCHANGED), sans dépendance supplémentaire ;
+//   - les vidéos avec alpha (PNG / QTRLE en MOV, FFV1, VP9 alpha en WebM...)
+//     via libavformat / libavcodec / libswscale si compilé avec HAVE_LIBAV.
+// Les images sans alpha sont complétées par un alpha opaque.
+
+class AlphaCapture {
+public:
+    AlphaCapture() = default;
+    AlphaCapture(const AlphaCapture&) = delete;
+    AlphaCapture& operator=(const AlphaCapture&) = delete;
+    ~AlphaCapture() { release(); }
+
+    // decoder : lire aussi les fichiers image (PNG, WebP animés...) avec le décodeur
+    // vidéo ; échec silencieux sans libav (l'appelant retombe sur imread).
+    bool open(const std::string& path, bool decoder = false) {
+        release();
+        if (isImagePath(path) && (!decoder || path.find('%') != std::string::npos)) return openSequence(path);
+#ifdef HAVE_LIBAV
+        return openVideo(path);
+#else
+        if (decoder) return false;
+        std::cerr << "Erreur: vidéo avec alpha non supportée sans libav (HAVE_LIBAV): " << path
+                  << "\n  Utiliser une séquence d'images PNG (ex: anim_%04d.png)\n";
+        return false;
+#endif
+    }
+
+    bool isOpened() const { return opened_; }
+
+    double get(int propId) const {
+        if (!opened_) return 0.0;
+        switch (propId) {
+            case cv::CAP_PROP_FRAME_WIDTH:  return size_.width;
+            case cv::CAP_PROP_FRAME_HEIGHT: return size_.height;
+            case cv::CAP_PROP_FPS:          return fps_;  // 0 pour une séquence : fps de la vidéo principale
+            case cv::CAP_PROP_FRAME_COUNT:  return count_;
+            case cv::CAP_PROP_POS_FRAMES:   return pos_;
+            case cv::CAP_PROP_POS_MSEC:     return msec_;  // dernière frame lue (0 pour une séquence)
+            default: return 0.0;
+        }
+    }
+
+    // Passe la frame suivante sans la convertir en BGRA.
+    bool grab() {
+        if (!opened_) return false;
+        if (sequence_) {
+            if (pos_ >= count_) return false;
+            pos_++;
+            return true;
+        }
+#ifdef HAVE_LIBAV
+        if (!decodeNext()) return false;
+        pos_++;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool read(cv::Mat& bgra) {
+        if (!opened_) return false;
+        if (sequence_) {
+            if (pos_ >= count_) return false;
+            cv::Mat img = cv::imread(frameName(pos_), cv::IMREAD_UNCHANGED);
+            if (img.empty()) return false;
+            toBGRA(img, bgra);
+            pos_++;
+            return true;
+        }
+#ifdef HAVE_LIBAV
+        if (!decodeNext()) return false;
+        bgra.create(frame_->height, frame_->width, CV_8UC4);
+        sws_ = sws_getCachedContext(sws_, frame_->width, frame_->height,
+                                    static_cast<AVPixelFormat>(frame_->format),
+                                    frame_->width, frame_->height, AV_PIX_FMT_BGRA,
+                                    SWS_POINT, nullptr, nullptr, nullptr);
+        if (!sws_) return false;
+        uint8_t* dst[4] = { bgra.data, nullptr, nullptr, nullptr };
+        int dstStride[4] = { static_cast<int>(bgra.step), 0, 0, 0 };
+        sws_scale(sws_, frame_->data, frame_->linesize, 0, frame_->height, dst, dstStride);
+        if (frame_->best_effort_timestamp != AV_NOPTS_VALUE) {
+            msec_ = frame_->best_effort_timestamp * av_q2d(fmt_->streams[stream_]->time_base) * 1000.0;
+        }
+        pos_++;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Seul CAP_PROP_POS_FRAMES est supporté.
+    bool set(int propId, double value) {
+        if (!opened_ || propId != cv::CAP_PROP_POS_FRAMES) return false;
+        int index = std::max(0, static_cast<int>(value));
+        if (sequence_) {
+            pos_ = index;
+            return true;
+        }
+#ifdef HAVE_LIBAV
+        return seekVideo(index);
+#else
+        return false;
+#endif
+    }
+
+    void release() {
+#ifdef HAVE_LIBAV
+        if (sws_) sws_freeContext(sws_);
+        if (frame_) av_frame_free(&frame_);
+        if (pkt_) av_packet_free(&pkt_);
+        if (ctx_) avcodec_free_context(&ctx_);
+        if (fmt_) avformat_close_input(&fmt_);
+        sws_ = nullptr;
+        stream_ = -1;
+        eof_ = false;
+        skipUntil_ = AV_NOPTS_VALUE;
+#endif
+        opened_ = sequence_ = false;
+        pos_ = count_ = 0;
+        fps_ = 0.0;
+        msec_ = 0.0;
+        size_ = cv::Size();
+    }
+
+    // Vrai si le fichier est lu par imread (séquence ou image fixe) plutôt que par un décodeur vidéo.
+    static bool isImagePath(const std::string& path) {
+        if (path.find('%') != std::string::npos) return true;
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) return false;
+        std::string ext = path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == "png" || ext == "tif" || ext == "tiff" || ext == "webp" || ext == "exr";
+    }
+
+    // Convertit n'importe quelle image lue par imread en BGRA 8 bits.
+    static void toBGRA(const cv::Mat& img, cv::Mat& bgra) {
+        cv::Mat img8;
+        if (img.depth() == CV_8U) {
+            img8 = img;
+        } else if (img.depth() == CV_16U) {
+            img.convertTo(img8, CV_8U, 1.0 / 257.0);
+        } else {
+            img.convertTo(img8, CV_8U, 255.0);
+        }
+        switch (img8.channels()) {
+            case 4: img8.copyTo(bgra); break;
+            case 3: cv::cvtColor(img8, bgra, cv::COLOR_BGR2BGRA); break;
+            default: cv::cvtColor(img8, bgra, cv::COLOR_GRAY2BGRA); break;
+        }
+    }
+
+private:
+    std::string frameName(int index) const {
+        if (pattern_.find('%') == std::string::npos) return pattern_;
+        std::vector<char> buf(pattern_.size() + 32);
+        std::snprintf(buf.data(), buf.size(), pattern_.c_str(), first_ + index);
+        return std::string(buf.data());
+    }
+
+    static bool exists(const std::string& path) {
+        std::ifstream f(path);
+        return f.good();
+    }
+
+    bool openSequence(const std::string& path) {
+        pattern_ = path;
+        sequence_ = true;
+        first_ = 0;
+        if (path.find('%') != std::string::npos) {
+            // Premier index à 0 ou 1, puis comptage jusqu'au premier fichier manquant
+            if (!exists(frameName(0))) first_ = 1;
+            while (exists(frameName(count_))) count_++;
+        } else {
+            count_ = exists(path) ? 1 : 0;
+        }
+        if (count_ == 0) {
+            sequence_ = false;
+            return false;
+        }
+        cv::Mat img = cv::imread(frameName(0), cv::IMREAD_UNCHANGED);
+        if (img.empty()) {
+            sequence_ = false;
+            return false;
+        }
+        size_ = img.size();
+        opened_ = true;
+        return true;
+    }
+
+#ifdef HAVE_LIBAV
+    bool openVideo(const std::string& path) {
+        if (avformat_open_input(&fmt_, path.c_str(), nullptr, nullptr) < 0) return false;
+        if (avformat_find_stream_info(fmt_, nullptr) < 0) return false;
+        stream_ = av_find_best_stream(fmt_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (stream_ < 0) return false;
+        AVStream* st = fmt_->streams[stream_];
+
+        // Le décodeur VP9 natif ignore le plan alpha des WebM : préférer libvpx
+        const AVCodec* codec = nullptr;
+        if (st->codecpar->codec_id == AV_CODEC_ID_VP9) codec = avcodec_find_decoder_by_name("libvpx-vp9");
+        if (!codec) codec = avcodec_find_decoder(st->codecpar->codec_id);
+        if (!codec) return false;
+
+        ctx_ = avcodec_alloc_context3(codec);
+        if (!ctx_ || avcodec_parameters_to_context(ctx_, st->codecpar) < 0) return false;
+        ctx_->thread_count = 0;
+        if (avcodec_open2(ctx_, codec, nullptr) < 0) return false;
+        frame_ = av_frame_alloc();
+        pkt_ = av_packet_alloc();
+        if (!frame_ || !pkt_) return false;
+
+        AVRational rate = st->avg_frame_rate.num ? st->avg_frame_rate : st->r_frame_rate;
+        fps_ = rate.num ? av_q2d(rate) : 0.0;
+        count_ = static_cast<int>(st->nb_frames);
+        if (count_ <= 0 && fmt_->duration > 0 && fps_ > 0) {
+            count_ = static_cast<int>(std::llround(fmt_->duration / double(AV_TIME_BASE) * fps_));
+        }
+        size_ = cv::Size(ctx_->width, ctx_->height);
+        opened_ = true;
+        return true;
+    }
+
+    // Décode la frame suivante dans frame_ ; les frames antérieures à skipUntil_ (après un seek) sont ignorées.
+    bool decodeNext() {
+        while (true) {
+            int r = avcodec_receive_frame(ctx_, frame_);
+            if (r == 0) {
+                int64_t pts = frame_->best_effort_timestamp;
+                if (skipUntil_ != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts < skipUntil_) continue;
+                skipUntil_ = AV_NOPTS_VALUE;
+                return true;
+            }
+            if (r != AVERROR(EAGAIN) || eof_) return false;
+
+            if (av_read_frame(fmt_, pkt_) < 0) {
+                eof_ = true;
+                avcodec_send_packet(ctx_, nullptr);  // vide les frames retenues par le décodeur
+                continue;
+            }
+            if (pkt_->stream_index == stream_) avcodec_send_packet(ctx_, pkt_);
+            av_packet_unref(pkt_);
+        }
+    }
+
+    // Seek vers la keyframe précédente, puis décodage jusqu'à la frame demandée.
+    bool seekVideo(int index) {
+        AVStream* st = fmt_->streams[stream_];
+        if (fps_ <= 0) return false;
+        int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        double tb = av_q2d(st->time_base);
+        int64_t target = start + static_cast<int64_t>(std::llround(index / fps_ / tb));
+        // Tolérance d'une demi-frame sur les pts arrondis
+        int64_t halfFrame = static_cast<int64_t>(0.5 / fps_ / tb);
+        if (av_seek_frame(fmt_, stream_, target, AVSEEK_FLAG_BACKWARD) < 0) return false;
+        avcodec_flush_buffers(ctx_);
+        eof_ = false;
+        skipUntil_ = target - halfFrame;
+        pos_ = index;
+        return true;
+    }
+
+    AVFormatContext* fmt_ = nullptr;
+    AVCodecContext* ctx_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* pkt_ = nullptr;
+    SwsContext* sws_ = nullptr;
+    int stream_ = -1;
+    bool eof_ = false;
+    int64_t skipUntil_ = AV_NOPTS_VALUE;
+#endif
+
+    bool opened_ = false;
+    bool sequence_ = false;
+    std::string pattern_;
+    int first_ = 0;
+    int count_ = 0;
+    int pos_ = 0;
+    double fps_ = 0.0;
+    double msec_ = 0.0;
+    cv::Size size_;
+};
+
+#endif // ALPHA_CAPTURE_H
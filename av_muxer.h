@@ -0,0 +1,294 @@
+#ifndef AV_MUXER_H
+#define AV_MUXER_H
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+
+#ifdef HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+// Écriture de la vidéo finale en un seul passage, audio compris.
+//
+// Auparavant la vidéo MJPG était écrite par cv::VideoWriter, renommée en
+// fichier temporaire (mv), remuxée avec l'audio de la source par un ffmpeg
+// externe, puis supprimée (rm) : deux écritures complètes sur disque, ffmpeg
+// requis dans le PATH, et des commandes shell cassées par les guillemets dans
+// les chemins. Avec libav (HAVE_LIBAV), MediaWriter encode les frames et
+// copie les paquets audio de la source (sans les décoder) dans le même
+// conteneur, entrelacés au fil de l'eau : ni fichier temporaire ni
+// sous-processus. Comme `-shortest`, l'audio s'arrête avec la vidéo.
+// Sans libav, on retombe sur cv::VideoWriter (MJPG, sans audio).
+
+class MediaWriter {
+public:
+    MediaWriter() = default;
+    MediaWriter(const MediaWriter&) = delete;
+    MediaWriter& operator=(const MediaWriter&) = delete;
+    ~MediaWriter() { release(); }
+
+    // Threads de l'encodeur (0 = automatique), à fixer avant open()
+    void setThreads(int threads) { threads_ = threads; }
+
+    // Ouvre `path` ; l'audio de `audioSource` (s'il y en a un) est recopié tel quel.
+    bool open(const std::string& path, double fps, cv::Size size, const std::string& audioSource = std::string()) {
+        release();
+#ifdef HAVE_LIBAV
+        if (openMuxer(path, fps, size, audioSource)) return true;
+        release();
+        return false;
+#else
+        (void)audioSource;
+        (void)threads_;
+        writer_.open(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, size);
+        return writer_.isOpened();
+#endif
+    }
+
+    bool isOpened() const {
+#ifdef HAVE_LIBAV
+        return out_ != nullptr;
+#else
+        return writer_.isOpened();
+#endif
+    }
+
+    // Vrai si une piste audio est copiée dans la sortie
+    bool hasAudio() const {
+#ifdef HAVE_LIBAV
+        return audioOut_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    // Nom de l'encodeur vidéo utilisé
+    std::string codecName() const {
+#ifdef HAVE_LIBAV
+        return enc_ ? enc_->codec->name : "";
+#else
+        return "MJPG";
+#endif
+    }
+
+    // Encode une frame BGR de la taille donnée à open().
+    bool write(const cv::Mat& bgr) {
+#ifdef HAVE_LIBAV
+        if (!out_ || bgr.type() != CV_8UC3 || bgr.cols != enc_->width || bgr.rows != enc_->height) return false;
+        if (av_frame_make_writable(frame_) < 0) return false;
+        const uint8_t* src[4] = { bgr.data, nullptr, nullptr, nullptr };
+        int srcStride[4] = { static_cast<int>(bgr.step), 0, 0, 0 };
+        sws_scale(sws_, src, srcStride, 0, bgr.rows, frame_->data, frame_->linesize);
+        frame_->pts = frames_++;
+        if (!encode(frame_)) return false;
+        // Audio entrelacé jusqu'à la fin de cette frame
+        return copyAudio(frames_ * av_q2d(enc_->time_base));
+#else
+        writer_.write(bgr);
+        return true;
+#endif
+    }
+
+    // Vide l'encodeur, termine l'audio et ferme le fichier.
+    void release() {
+#ifdef HAVE_LIBAV
+        if (out_ && headerWritten_) {
+            encode(nullptr);
+            copyAudio(frames_ * av_q2d(enc_->time_base));
+            av_write_trailer(out_);
+        }
+        if (out_ && !(out_->oformat->flags & AVFMT_NOFILE)) avio_closep(&out_->pb);
+        if (out_) avformat_free_context(out_);
+        if (in_) avformat_close_input(&in_);
+        if (enc_) avcodec_free_context(&enc_);
+        if (frame_) av_frame_free(&frame_);
+        if (pkt_) av_packet_free(&pkt_);
+        if (audioPkt_) av_packet_free(&audioPkt_);
+        if (sws_) sws_freeContext(sws_);
+        out_ = nullptr;
+        sws_ = nullptr;
+        videoOut_ = audioOut_ = nullptr;
+        audioIn_ = -1;
+        audioHeld_ = audioEof_ = headerWritten_ = false;
+        frames_ = 0;
+#else
+        writer_.release();
+#endif
+    }
+
+private:
+    int threads_ = 0;
+
+#ifdef HAVE_LIBAV
+    bool openMuxer(const std::string& path, double fps, cv::Size size, const std::string& audioSource) {
+        if (avformat_alloc_output_context2(&out_, nullptr, nullptr, path.c_str()) < 0 || !out_) {
+            std::cerr << "Erreur: format de sortie inconnu: " << path << "\n";
+            return false;
+        }
+
+        // MJPEG comme l'ancienne sortie si le conteneur l'accepte, sinon le codec par défaut du conteneur
+        AVCodecID codecId = AV_CODEC_ID_MJPEG;
+        if (avformat_query_codec(out_->oformat, codecId, FF_COMPLIANCE_NORMAL) != 1) {
+            codecId = out_->oformat->video_codec;
+        }
+        const AVCodec* codec = avcodec_find_encoder(codecId);
+        if (!codec) {
+            std::cerr << "Erreur: aucun encodeur vidéo pour " << path << "\n";
+            return false;
+        }
+        enc_ = avcodec_alloc_context3(codec);
+        if (!enc_) return false;
+        enc_->width = size.width;
+        enc_->height = size.height;
+        enc_->time_base = av_inv_q(av_d2q(fps > 0 ? fps : 25.0, 100000));
+        enc_->framerate = av_inv_q(enc_->time_base);
+        enc_->pix_fmt = codecId == AV_CODEC_ID_MJPEG ? AV_PIX_FMT_YUVJ420P
+                      : codec->pix_fmts ? codec->pix_fmts[0] : AV_PIX_FMT_YUV420P;
+        enc_->thread_count = threads_;
+        if (codecId == AV_CODEC_ID_MJPEG) {
+            // Qualité fixe, proche de celle de cv::VideoWriter
+            enc_->flags |= AV_CODEC_FLAG_QSCALE;
+            enc_->global_quality = FF_QP2LAMBDA * 2;
+        }
+        if (out_->oformat->flags & AVFMT_GLOBALHEADER) enc_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (avcodec_open2(enc_, codec, nullptr) < 0) {
+            std::cerr << "Erreur: impossible d'ouvrir l'encodeur " << codec->name << "\n";
+            return false;
+        }
+
+        videoOut_ = avformat_new_stream(out_, nullptr);
+        if (!videoOut_ || avcodec_parameters_from_context(videoOut_->codecpar, enc_) < 0) return false;
+        videoOut_->time_base = enc_->time_base;
+
+        frame_ = av_frame_alloc();
+        pkt_ = av_packet_alloc();
+        audioPkt_ = av_packet_alloc();
+        if (!frame_ || !pkt_ || !audioPkt_) return false;
+        frame_->format = enc_->pix_fmt;
+        frame_->width = enc_->width;
+        frame_->height = enc_->height;
+        frame_->quality = enc_->global_quality;
+        if (av_frame_get_buffer(frame_, 0) < 0) return false;
+        sws_ = sws_getContext(size.width, size.height, AV_PIX_FMT_BGR24, size.width, size.height, enc_->pix_fmt,
+                              SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws_) return false;
+
+        if (!audioSource.empty()) openAudio(audioSource);
+
+        if (!(out_->oformat->flags & AVFMT_NOFILE) && avio_open(&out_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+            std::cerr << "Erreur: impossible d'écrire " << path << "\n";
+            return false;
+        }
+        if (avformat_write_header(out_, nullptr) < 0) return false;
+        headerWritten_ = true;
+        return true;
+    }
+
+    // Piste audio de la source recopiée sans décodage ; absence ou codec refusé : sortie muette.
+    void openAudio(const std::string& source) {
+        if (avformat_open_input(&in_, source.c_str(), nullptr, nullptr) < 0) return;
+        if (avformat_find_stream_info(in_, nullptr) < 0) return closeAudio();
+        audioIn_ = av_find_best_stream(in_, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (audioIn_ < 0) return closeAudio();
+        AVStream* st = in_->streams[audioIn_];
+        if (avformat_query_codec(out_->oformat, st->codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+            std::cerr << "⚠ Audio " << avcodec_get_name(st->codecpar->codec_id)
+                      << " non supporté par le conteneur de sortie : vidéo sans audio\n";
+            return closeAudio();
+        }
+        for (unsigned i = 0; i < in_->nb_streams; i++) {
+            if (static_cast<int>(i) != audioIn_) in_->streams[i]->discard = AVDISCARD_ALL;
+        }
+        audioOut_ = avformat_new_stream(out_, nullptr);
+        if (!audioOut_ || avcodec_parameters_copy(audioOut_->codecpar, st->codecpar) < 0) {
+            audioOut_ = nullptr;
+            return closeAudio();
+        }
+        audioOut_->codecpar->codec_tag = 0;
+        audioOut_->time_base = st->time_base;
+        // L'audio démarre avec la première frame vidéo de la source
+        audioStart_ = in_->start_time != AV_NOPTS_VALUE
+                    ? av_rescale_q(in_->start_time, AV_TIME_BASE_Q, st->time_base) : 0;
+    }
+
+    void closeAudio() {
+        if (in_) avformat_close_input(&in_);
+        audioIn_ = -1;
+    }
+
+    // Envoie `frame` (nullptr = vidage) à l'encodeur et écrit les paquets produits.
+    bool encode(AVFrame* frame) {
+        if (avcodec_send_frame(enc_, frame) < 0) return false;
+        while (true) {
+            int r = avcodec_receive_packet(enc_, pkt_);
+            if (r == AVERROR(EAGAIN) || r == AVERROR_EOF) return true;
+            if (r < 0) return false;
+            av_packet_rescale_ts(pkt_, enc_->time_base, videoOut_->time_base);
+            pkt_->stream_index = videoOut_->index;
+            if (av_interleaved_write_frame(out_, pkt_) < 0) return false;
+        }
+    }
+
+    // Copie les paquets audio dont le début précède `until` (s) ; le premier au-delà est gardé pour plus tard.
+    bool copyAudio(double until) {
+        if (!audioOut_) return true;
+        AVStream* st = in_->streams[audioIn_];
+        const double tb = av_q2d(st->time_base);
+        while (!audioEof_) {
+            if (!audioHeld_) {
+                if (av_read_frame(in_, audioPkt_) < 0) {
+                    audioEof_ = true;
+                    break;
+                }
+                if (audioPkt_->stream_index != audioIn_) {
+                    av_packet_unref(audioPkt_);
+                    continue;
+                }
+                audioHeld_ = true;
+            }
+            int64_t ts = audioPkt_->pts != AV_NOPTS_VALUE ? audioPkt_->pts : audioPkt_->dts;
+            if (ts != AV_NOPTS_VALUE && (ts - audioStart_) * tb >= until) break;
+            if (ts != AV_NOPTS_VALUE && ts < audioStart_) {
+                // Avant la première frame vidéo
+                av_packet_unref(audioPkt_);
+                audioHeld_ = false;
+                continue;
+            }
+
+            if (audioPkt_->pts != AV_NOPTS_VALUE) audioPkt_->pts -= audioStart_;
+            if (audioPkt_->dts != AV_NOPTS_VALUE) audioPkt_->dts -= audioStart_;
+            av_packet_rescale_ts(audioPkt_, st->time_base, audioOut_->time_base);
+            audioPkt_->stream_index = audioOut_->index;
+            audioPkt_->pos = -1;
+            audioHeld_ = false;
+            if (av_interleaved_write_frame(out_, audioPkt_) < 0) return false;
+        }
+        return true;
+    }
+
+    AVFormatContext* out_ = nullptr;
+    AVFormatContext* in_ = nullptr;
+    AVCodecContext* enc_ = nullptr;
+    AVStream* videoOut_ = nullptr;
+    AVStream* audioOut_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* pkt_ = nullptr;
+    AVPacket* audioPkt_ = nullptr;
+    SwsContext* sws_ = nullptr;
+    int audioIn_ = -1;
+    int64_t audioStart_ = 0;
+    bool audioHeld_ = false;
+    bool audioEof_ = false;
+    bool headerWritten_ = false;
+    int64_t frames_ = 0;
+#else
+    cv::VideoWriter writer_;
+#endif
+};
+
+#endif // AV_MUXER_H
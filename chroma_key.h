@@ -0,0 +1,173 @@
+#ifndef CHROMA_KEY_H
+#define CHROMA_KEY_H
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <iostream>
+
+// Calcul du masque de chroma key (matte) sur une image BGR 8 bits.
+//
+// Distance L1 entre chaque pixel et la couleur de clé :
+//   diff = |B-kB| + |G-kG| + |R-kR|            (0..765)
+// Mode binaire (softness == 0) : alpha = diff < tolerance*3 ? 0 : 255,
+// identique à l'ancienne boucle de applyChromaKey / createMaskFromChromaKey.
+// Mode doux (softness > 0) : rampe linéaire de `softness` niveaux de diff
+//   alpha = round(clamp(diff + 1 - tolerance*3, 0, softness) * 255 / softness)
+// softness == 1 redonne exactement le masque binaire.
+//
+// Le noyau SIMD (universal intrinsics OpenCV) et le repli scalaire donnent
+// des résultats identiques au bit près.
+
+namespace chroma {
+
+struct MatteParams {
+    int keyB = 0, keyG = 255, keyR = 0;
+    int threshold = 120;  // tolerance * 3, borné à [0, 766]
+    int softness = 0;     // 0 = masque binaire
+    float scale = 0.f;    // 255 / softness
+
+    MatteParams(const cv::Vec3b& key, int tolerance, int soft)
+        : keyB(key[0]), keyG(key[1]), keyR(key[2]) {
+        threshold = std::min(std::max(tolerance * 3, 0), 766);
+        softness = std::min(std::max(soft, 0), 765);
+        scale = softness > 0 ? 255.f / softness : 0.f;
+    }
+};
+
+inline void matteRowScalar(const uchar* src, uchar* dst, int n, const MatteParams& p) {
+    for (int x = 0; x < n; x++, src += 3) {
+        int diff = std::abs(src[0] - p.keyB) +
+                   std::abs(src[1] - p.keyG) +
+                   std::abs(src[2] - p.keyR);
+        if (p.softness == 0) {
+            dst[x] = diff < p.threshold ? 0 : 255;
+        } else {
+            int a = std::min(std::max(diff + 1 - p.threshold, 0), p.softness);
+            dst[x] = cv::saturate_cast<uchar>(cvRound(static_cast<float>(a) * p.scale));
+        }
+    }
+}
+
+// Traite le début de la ligne en SIMD, retourne le nombre de pixels traités.
+inline int matteRowSimd(const uchar* src, uchar* dst, int n, const MatteParams& p) {
+    int x = 0;
+#if CV_SIMD || CV_SIMD_SCALABLE
+    const int VL = cv::VTraits<cv::v_uint8>::vlanes();
+    const cv::v_uint8 kb = cv::vx_setall_u8(static_cast<uchar>(p.keyB));
+    const cv::v_uint8 kg = cv::vx_setall_u8(static_cast<uchar>(p.keyG));
+    const cv::v_uint8 kr = cv::vx_setall_u8(static_cast<uchar>(p.keyR));
+    const cv::v_uint16 thr = cv::vx_setall_u16(static_cast<ushort>(p.threshold));
+
+    if (p.softness == 0) {
+        for (; x <= n - VL; x += VL) {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(src + 3 * x, b, g, r);
+            cv::v_uint16 b0, b1, g0, g1, r0, r1;
+            cv::v_expand(cv::v_absdiff(b, kb), b0, b1);
+            cv::v_expand(cv::v_absdiff(g, kg), g0, g1);
+            cv::v_expand(cv::v_absdiff(r, kr), r0, r1);
+            // Comparaison -> 0xFFFF / 0, v_pack sature à 255 / 0
+            cv::v_uint16 m0 = cv::v_ge(cv::v_add(cv::v_add(b0, g0), r0), thr);
+            cv::v_uint16 m1 = cv::v_ge(cv::v_add(cv::v_add(b1, g1), r1), thr);
+            cv::v_store(dst + x, cv::v_pack(m0, m1));
+        }
+    } else {
+        const cv::v_uint16 one = cv::vx_setall_u16(1);
+        const cv::v_uint16 soft = cv::vx_setall_u16(static_cast<ushort>(p.softness));
+        const cv::v_float32 scale = cv::vx_setall_f32(p.scale);
+        for (; x <= n - VL; x += VL) {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(src + 3 * x, b, g, r);
+            cv::v_uint16 b0, b1, g0, g1, r0, r1;
+            cv::v_expand(cv::v_absdiff(b, kb), b0, b1);
+            cv::v_expand(cv::v_absdiff(g, kg), g0, g1);
+            cv::v_expand(cv::v_absdiff(r, kr), r0, r1);
+            // Soustraction saturée : clamp bas à 0 gratuit
+            cv::v_uint16 a0 = cv::v_min(cv::v_sub(cv::v_add(cv::v_add(b0, g0), cv::v_add(r0, one)), thr), soft);
+            cv::v_uint16 a1 = cv::v_min(cv::v_sub(cv::v_add(cv::v_add(b1, g1), cv::v_add(r1, one)), thr), soft);
+
+            cv::v_uint32 q0, q1, q2, q3;
+            cv::v_expand(a0, q0, q1);
+            cv::v_expand(a1, q2, q3);
+            cv::v_int32 i0 = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(q0)), scale));
+            cv::v_int32 i1 = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(q1)), scale));
+            cv::v_int32 i2 = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(q2)), scale));
+            cv::v_int32 i3 = cv::v_round(cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(q3)), scale));
+            cv::v_store(dst + x, cv::v_pack_u(cv::v_pack(i0, i1), cv::v_pack(i2, i3)));
+        }
+    }
+    cv::vx_cleanup();
+#else
+    (void)src; (void)dst; (void)n; (void)p;
+#endif
+    return x;
+}
+
+// Calcule le matte de `bgr` (CV_8UC3) dans `alpha` (CV_8UC1, réalloué si besoin).
+inline void computeMatte(const cv::Mat& bgr, cv::Mat& alpha, const cv::Vec3b& key,
+                         int tolerance, int softness = 0, bool useSimd = true) {
+    CV_Assert(bgr.type() == CV_8UC3);
+    alpha.create(bgr.size(), CV_8UC1);
+    MatteParams p(key, tolerance, softness);
+
+    int rows = bgr.rows, cols = bgr.cols;
+    if (bgr.isContinuous() && alpha.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+    for (int y = 0; y < rows; y++) {
+        const uchar* src = bgr.ptr<uchar>(y);
+        uchar* dst = alpha.ptr<uchar>(y);
+        int x = useSimd ? matteRowSimd(src, dst, cols, p) : 0;
+        matteRowScalar(src + 3 * x, dst + x, cols - x, p);
+    }
+}
+
+// Micro-benchmark : débit (pixels/s) des chemins scalaire et SIMD,
+// en binaire et en rampe douce, et vérification de l'égalité bit à bit.
+inline void benchmarkMatte(cv::Size size = cv::Size(1920, 1080), int iterations = 50) {
+    cv::Mat img(size, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(256));
+    // Une moitié d'image proche du vert pour exercer les deux branches
+    img(cv::Rect(0, 0, size.width / 2, size.height)).setTo(cv::Scalar(10, 240, 12));
+
+    const cv::Vec3b key(0, 255, 0);
+    const int tolerance = 40;
+    const double pixels = static_cast<double>(size.area()) * iterations;
+
+    std::cout << "Benchmark chroma key " << size.width << "x" << size.height
+              << ", " << iterations << " itérations"
+#if CV_SIMD || CV_SIMD_SCALABLE
+              << " (SIMD " << cv::VTraits<cv::v_uint8>::vlanes() * 8 << " bits)"
+#else
+              << " (SIMD indisponible)"
+#endif
+              << "\n";
+
+    const int softnessValues[] = { 0, 32 };
+    for (int softness : softnessValues) {
+        cv::Mat ref, simd;
+        double rate[2] = { 0.0, 0.0 };
+        for (int pass = 0; pass < 2; pass++) {
+            cv::Mat& out = pass == 0 ? ref : simd;
+            computeMatte(img, out, key, tolerance, softness, pass == 1);
+            int64 t0 = cv::getTickCount();
+            for (int i = 0; i < iterations; i++) {
+                computeMatte(img, out, key, tolerance, softness, pass == 1);
+            }
+            double sec = (cv::getTickCount() - t0) / cv::getTickFrequency();
+            rate[pass] = sec > 0 ? pixels / sec : 0.0;
+        }
+        bool exact = cv::norm(ref, simd, cv::NORM_INF) == 0;
+        std::cout << "  " << (softness == 0 ? "binaire" : "doux   ")
+                  << "  scalaire: " << rate[0] / 1e6 << " Mpx/s"
+                  << "  SIMD: " << rate[1] / 1e6 << " Mpx/s"
+                  << "  x" << (rate[0] > 0 ? rate[1] / rate[0] : 0.0)
+                  << (exact ? "  [identique]" : "  [DIFFÉRENT]") << "\n";
+    }
+}
+
+} // namespace chroma
+
+#endif // CHROMA_KEY_H
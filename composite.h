@@ -0,0 +1,305 @@
+#ifndef COMPOSITE_H
+#define COMPOSITE_H
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Incrustation d'un overlay BGR dans une frame BGR, limitée à la zone visible.
+//
+// Le rectangle de l'overlay est découpé une seule fois contre la frame, puis
+// chaque ligne est parcourue par pointeurs bruts en segments de masque :
+//   - masque à 0   : segment ignoré (transparent)
+//   - masque à 255 : memcpy de la ligne de l'overlay (opaque)
+//   - autre valeur : mélange alpha 8 bits, arrondi exact
+// Le coût est donc proportionnel à la surface visible, et quasi nul pour les
+// zones transparentes.
+//
+// Les overlays à canal alpha natif (BGRA) passent par overlayPremultiplied :
+// couleur prémultipliée une fois au décodage, puis un seul produit par canal.
+//
+// Les overlays fixes (image, filigrane) passent par PremultipliedOverlay :
+// couleur prémultipliée et alpha inverse, opacité comprise, sont calculés une
+// seule fois au chargement, avec la liste des segments opaques / partiels de
+// chaque ligne ; par frame il ne reste que des memcpy et un produit entier par
+// octet, en SIMD, sur les seuls segments partiels.
+
+namespace composite {
+
+// Fin du segment [x, n) dont tous les octets valent v (lecture par mots de 8 octets).
+inline int runEnd(const uchar* m, int x, int n, uchar v) {
+    const uint64_t pattern = v ? ~uint64_t(0) : uint64_t(0);
+    while (x + 8 <= n) {
+        uint64_t w;
+        std::memcpy(&w, m + x, 8);
+        if (w != pattern) break;
+        x += 8;
+    }
+    while (x < n && m[x] == v) x++;
+    return x;
+}
+
+// (x + 127) / 255 exact pour x dans [0, 255*255]
+inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline void blendPixel(const uchar* f, uchar* d, int a) {
+    const int ia = 255 - a;
+    d[0] = static_cast<uchar>(div255(f[0] * a + d[0] * ia));
+    d[1] = static_cast<uchar>(div255(f[1] * a + d[1] * ia));
+    d[2] = static_cast<uchar>(div255(f[2] * a + d[2] * ia));
+}
+
+// Calcule les zones visibles ; retourne false si rien n'est visible.
+inline bool clipOverlay(const cv::Size& bgSize, const cv::Size& fgSize, cv::Point pos,
+                        cv::Rect& dstRoi, cv::Rect& srcRoi) {
+    dstRoi = cv::Rect(pos, fgSize) & cv::Rect(cv::Point(0, 0), bgSize);
+    if (dstRoi.empty()) return false;
+    srcRoi = cv::Rect(dstRoi.tl() - pos, dstRoi.size());
+    return true;
+}
+
+// Incruste `w` pixels d'une ligne BGR en segments de masque (m == nullptr : opaque).
+inline void overlayRow(uchar* d, const uchar* f, const uchar* m, int w, bool binary) {
+    if (!m) {
+        std::memcpy(d, f, static_cast<size_t>(w) * 3);
+        return;
+    }
+    int x = 0;
+    while (x < w) {
+        if (m[x] == 0) {
+            x = runEnd(m, x, w, 0);
+        } else if (m[x] == 255) {
+            int end = runEnd(m, x, w, 255);
+            std::memcpy(d + x * 3, f + x * 3, static_cast<size_t>(end - x) * 3);
+            x = end;
+        } else if (binary) {
+            // Masque non binaire traité comme opaque : on copie le segment non nul
+            int end = x;
+            while (end < w && m[end] != 0) end++;
+            std::memcpy(d + x * 3, f + x * 3, static_cast<size_t>(end - x) * 3);
+            x = end;
+        } else {
+            for (; x < w && m[x] != 0 && m[x] != 255; x++) {
+                blendPixel(f + x * 3, d + x * 3, m[x]);
+            }
+        }
+    }
+}
+
+// Incrustation avec masque 8 bits.
+//   binary = true  : tout pixel de masque > 0 est opaque (ancien overlayImage)
+//   binary = false : le masque est un alpha 0..255
+// Un masque vide signifie « overlay entièrement opaque ».
+inline void overlayROI(cv::Mat& background, const cv::Mat& foreground, const cv::Mat& mask,
+                       cv::Point position, bool binary) {
+    CV_Assert(background.type() == CV_8UC3 && foreground.type() == CV_8UC3);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == foreground.size()));
+
+    cv::Rect dstRoi, srcRoi;
+    if (!clipOverlay(background.size(), foreground.size(), position, dstRoi, srcRoi)) return;
+
+    for (int y = 0; y < dstRoi.height; y++) {
+        uchar* d = background.ptr<uchar>(dstRoi.y + y) + dstRoi.x * 3;
+        const uchar* f = foreground.ptr<uchar>(srcRoi.y + y) + srcRoi.x * 3;
+        const uchar* m = mask.empty() ? nullptr : mask.ptr<uchar>(srcRoi.y + y) + srcRoi.x;
+        overlayRow(d, f, m, dstRoi.width, binary);
+    }
+}
+
+// Prémultiplie une image BGRA par son alpha, sur place (une fois par frame décodée).
+inline void premultiply(cv::Mat& bgra) {
+    CV_Assert(bgra.type() == CV_8UC4);
+    for (int y = 0; y < bgra.rows; y++) {
+        uchar* p = bgra.ptr<uchar>(y);
+        for (int x = 0; x < bgra.cols; x++, p += 4) {
+            const int a = p[3];
+            if (a == 255) continue;
+            p[0] = static_cast<uchar>(div255(p[0] * a));
+            p[1] = static_cast<uchar>(div255(p[1] * a));
+            p[2] = static_cast<uchar>(div255(p[2] * a));
+        }
+    }
+}
+
+// Mélange d'un pixel BGRA prémultiplié d'alpha a (0 < a < 255) : d = f + d * (255 - a) / 255
+inline void blendPremultipliedPixel(const uchar* f, uchar* d, int a) {
+    const int ia = 255 - a;
+    d[0] = cv::saturate_cast<uchar>(f[0] + div255(d[0] * ia));
+    d[1] = cv::saturate_cast<uchar>(f[1] + div255(d[1] * ia));
+    d[2] = cv::saturate_cast<uchar>(f[2] + div255(d[2] * ia));
+}
+
+// Incruste `w` pixels d'une ligne BGRA prémultipliée : transparents ignorés, opaques copiés.
+inline void premultipliedRow(uchar* d, const uchar* f, int w) {
+    for (int x = 0; x < w; x++, d += 3, f += 4) {
+        const int a = f[3];
+        if (a == 0) continue;
+        if (a == 255) {
+            d[0] = f[0];
+            d[1] = f[1];
+            d[2] = f[2];
+            continue;
+        }
+        blendPremultipliedPixel(f, d, a);
+    }
+}
+
+// Incrustation d'un overlay BGRA prémultiplié : d = f + d * (255 - a) / 255.
+// Même découpage que overlayROI ; les pixels transparents sont ignorés et les
+// pixels opaques copiés, sans multiplication.
+inline void overlayPremultiplied(cv::Mat& background, const cv::Mat& foreground, cv::Point position) {
+    CV_Assert(background.type() == CV_8UC3 && foreground.type() == CV_8UC4);
+
+    cv::Rect dstRoi, srcRoi;
+    if (!clipOverlay(background.size(), foreground.size(), position, dstRoi, srcRoi)) return;
+
+    for (int y = 0; y < dstRoi.height; y++) {
+        uchar* d = background.ptr<uchar>(dstRoi.y + y) + dstRoi.x * 3;
+        const uchar* f = foreground.ptr<uchar>(srcRoi.y + y) + srcRoi.x * 4;
+        premultipliedRow(d, f, dstRoi.width);
+    }
+}
+
+// Overlay fixe précalculé : d = color + d * invAlpha / 255.
+//
+// Le masque est analysé une fois en segments par ligne : transparents (omis),
+// opaques (memcpy de la couleur prémultipliée) et partiels (mélange). Un pixel
+// transparent ou opaque mélangé donne exactement le même résultat que s'il
+// était sauté ou copié : les segments de moins de kMinRun pixels sont donc
+// fusionnés dans les segments partiels voisins, pour que le noyau SIMD
+// travaille sur des segments longs.
+struct PremultipliedOverlay {
+    enum Kind : uchar { TRANSPARENT, OPAQUE, PARTIAL };
+    struct Run {
+        int x0, x1;  // colonnes [x0, x1)
+        Kind kind;
+    };
+    static const int kMinRun = 16;
+
+    cv::Mat color;                 // CV_8UC3, f * a / 255
+    cv::Mat invAlpha;              // CV_8UC3, 255 - a (répliqué par canal : noyau octet par octet)
+    std::vector<Run> runs;         // segments opaques et partiels, ligne par ligne
+    std::vector<int> rowRuns;      // segments de la ligne y : [rowRuns[y], rowRuns[y + 1])
+    long long pixels[3] = { 0, 0, 0 };  // pixels transparents / opaques / partiels (avant fusion)
+
+    long long total() const { return pixels[TRANSPARENT] + pixels[OPAQUE] + pixels[PARTIAL]; }
+    double fraction(Kind k) const { return total() ? double(pixels[k]) / total() : 0.0; }
+};
+
+// Précalcule l'overlay BGR `bgr`, son masque 8 bits et l'opacité (0..1).
+inline void precompute(const cv::Mat& bgr, const cv::Mat& mask, double opacity, PremultipliedOverlay& out) {
+    typedef PremultipliedOverlay P;
+    CV_Assert(bgr.type() == CV_8UC3 && mask.type() == CV_8UC1 && mask.size() == bgr.size());
+    const int op = cvRound(std::min(std::max(opacity, 0.0), 1.0) * 255.0);
+    out.color.create(bgr.size(), CV_8UC3);
+    out.invAlpha.create(bgr.size(), CV_8UC3);
+    out.runs.clear();
+    out.rowRuns.assign(1, 0);
+    out.pixels[P::TRANSPARENT] = out.pixels[P::OPAQUE] = out.pixels[P::PARTIAL] = 0;
+
+    std::vector<P::Run> raw;
+    for (int y = 0; y < bgr.rows; y++) {
+        const uchar* f = bgr.ptr<uchar>(y);
+        const uchar* m = mask.ptr<uchar>(y);
+        uchar* c = out.color.ptr<uchar>(y);
+        uchar* ia = out.invAlpha.ptr<uchar>(y);
+        raw.clear();
+        for (int x = 0; x < bgr.cols; x++, f += 3, c += 3, ia += 3) {
+            const int a = div255(m[x] * op);
+            c[0] = static_cast<uchar>(div255(f[0] * a));
+            c[1] = static_cast<uchar>(div255(f[1] * a));
+            c[2] = static_cast<uchar>(div255(f[2] * a));
+            ia[0] = ia[1] = ia[2] = static_cast<uchar>(255 - a);
+
+            P::Kind k = a == 0 ? P::TRANSPARENT : a == 255 ? P::OPAQUE : P::PARTIAL;
+            out.pixels[k]++;
+            if (!raw.empty() && raw.back().kind == k) {
+                raw.back().x1 = x + 1;
+            } else {
+                raw.push_back(P::Run{ x, x + 1, k });
+            }
+        }
+
+        // Segments courts fusionnés en partiels ; transparents des bords toujours omis
+        for (size_t i = 0; i < raw.size(); i++) {
+            P::Run r = raw[i];
+            const bool isShort = r.x1 - r.x0 < P::kMinRun;
+            if (r.kind == P::TRANSPARENT) {
+                if (!isShort || i == 0 || i + 1 == raw.size()) continue;
+                r.kind = P::PARTIAL;
+            } else if (r.kind == P::OPAQUE && isShort) {
+                r.kind = P::PARTIAL;
+            }
+            if (!out.runs.empty() && static_cast<int>(out.runs.size()) > out.rowRuns.back()
+                && out.runs.back().kind == r.kind && out.runs.back().x1 == r.x0) {
+                out.runs.back().x1 = r.x1;
+            } else {
+                out.runs.push_back(r);
+            }
+        }
+        out.rowRuns.push_back(static_cast<int>(out.runs.size()));
+    }
+}
+
+// d = c + (d * ia + 128) * 257 >> 16 sur n octets (division par 255 arrondie exacte)
+inline void blendPrecomputedRow(const uchar* c, const uchar* ia, uchar* d, int n) {
+    int x = 0;
+#if CV_SIMD || CV_SIMD_SCALABLE
+    const int VL = cv::VTraits<cv::v_uint8>::vlanes();
+    const cv::v_uint16 bias = cv::vx_setall_u16(128);
+    const cv::v_uint16 k257 = cv::vx_setall_u16(257);
+    for (; x <= n - VL; x += VL) {
+        cv::v_uint16 d0, d1, i0, i1;
+        cv::v_expand(cv::vx_load(d + x), d0, d1);
+        cv::v_expand(cv::vx_load(ia + x), i0, i1);
+        cv::v_uint16 t0 = cv::v_mul_hi(cv::v_add(cv::v_mul_wrap(d0, i0), bias), k257);
+        cv::v_uint16 t1 = cv::v_mul_hi(cv::v_add(cv::v_mul_wrap(d1, i1), bias), k257);
+        // Addition 8 bits saturée
+        cv::v_store(d + x, cv::v_add(cv::v_pack(t0, t1), cv::vx_load(c + x)));
+    }
+    cv::vx_cleanup();
+#endif
+    for (; x < n; x++) {
+        const int v = c[x] + (((d[x] * ia[x] + 128) * 257) >> 16);
+        d[x] = static_cast<uchar>(std::min(v, 255));
+    }
+}
+
+// Applique un overlay précalculé en parcourant ses segments, limité à la zone visible.
+inline void overlayPrecomputed(cv::Mat& background, const PremultipliedOverlay& ov, cv::Point position) {
+    typedef PremultipliedOverlay P;
+    CV_Assert(background.type() == CV_8UC3);
+
+    cv::Rect dstRoi, srcRoi;
+    if (!clipOverlay(background.size(), ov.color.size(), position, dstRoi, srcRoi)) return;
+    const int left = srcRoi.x, right = srcRoi.x + srcRoi.width;
+
+    for (int y = 0; y < dstRoi.height; y++) {
+        const int sy = srcRoi.y + y;
+        uchar* row = background.ptr<uchar>(dstRoi.y + y);
+        const uchar* c = ov.color.ptr<uchar>(sy);
+        const uchar* ia = ov.invAlpha.ptr<uchar>(sy);
+        for (int i = ov.rowRuns[sy]; i < ov.rowRuns[sy + 1]; i++) {
+            const P::Run& r = ov.runs[i];
+            const int x0 = std::max(r.x0, left), x1 = std::min(r.x1, right);
+            if (x0 >= x1) continue;
+            // Adresse calculée par segment : jamais avant le début de la ligne
+            uchar* d = row + (dstRoi.x + (x0 - left)) * 3;
+            if (r.kind == P::OPAQUE) {
+                std::memcpy(d, c + x0 * 3, static_cast<size_t>(x1 - x0) * 3);
+            } else {
+                blendPrecomputedRow(c + x0 * 3, ia + x0 * 3, d, (x1 - x0) * 3);
+            }
+        }
+    }
+}
+
+} // namespace composite
+
+#endif // COMPOSITE_H
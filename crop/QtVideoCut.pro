@@ -21,10 +21,21 @@ SOURCES += \
 
 HEADERS += \
     mainwindow.h \
-    range_slider.h
+    range_slider.h \
+    ../media_probe.h
+
+# media_probe.h et json.hpp sont partagés avec les outils en ligne de commande
+INCLUDEPATH += ..
 
 LIBS += -lopencv_core -lopencv_imgproc -lopencv_imgcodecs -lopencv_features2d  -lopencv_video  -lopencv_videoio
 
+# libavformat optionnel : nombre de frames exact (sinon estimation OpenCV)
+packagesExist(libavformat libavutil) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libavformat libavutil
+    DEFINES += HAVE_LIBAV
+}
+
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
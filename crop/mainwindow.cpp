@@ -13,6 +13,7 @@
 #include <QClipboard>          
 
 #include "range_slider.h"
+#include "media_probe.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -104,6 +105,11 @@ void MainWindow::openVideo(const QString &path)
 
     m_totalFrames = static_cast<int>(m_cap.get(cv::CAP_PROP_FRAME_COUNT));
     m_fps = m_cap.get(cv::CAP_PROP_FPS);
+
+    // CAP_PROP_FRAME_COUNT n'est qu'une estimation : nombre exact via le probe (mis en cache)
+    probe::MediaInfo info = probe::probe(path.toStdString());
+    if (info.exact) m_totalFrames = info.frames();
+    if (info.fps > 0.0) m_fps = info.fps;
     int w = static_cast<int>(m_cap.get(cv::CAP_PROP_FRAME_WIDTH));
     int h = static_cast<int>(m_cap.get(cv::CAP_PROP_FRAME_HEIGHT));
     m_frameSize = cv::Size(w, h);
@@ -0,0 +1,114 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "lz_codec.h"
+
+// Cache mémoire des frames d'overlay déjà préparées (redimensionnées et
+// détourées), compressées avec lz_codec.h. Sert aux overlays joués en boucle
+// ou en aller-retour : après le premier cycle, une frame ne coûte plus qu'une
+// décompression, sans décodage, redimensionnement ni chroma key.
+//
+// Le cache est borné en mémoire : put() refuse les frames qui dépasseraient
+// le budget, l'appelant retombe alors sur le décodage. La taille compressée
+// est estimée (taux moyen des frames déjà stockées) avant de compresser, et
+// une fois le cache plein put() refuse tout sans rien compresser.
+// Non thread-safe : utilisé uniquement par le thread de décodage de l'overlay.
+class FrameCache {
+public:
+    explicit FrameCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+    bool contains(int index) const { return entries_.count(index) != 0; }
+
+    // Compresse et stocke la frame ; false si le budget mémoire est dépassé.
+    bool put(int index, const cv::Mat& image, const cv::Mat& mask) {
+        if (contains(index)) return true;
+        if (full_) return false;
+
+        const size_t raw = image.total() * image.elemSize() + mask.total() * mask.elemSize();
+        if (rawBytes_ > 0 && bytes_ + static_cast<size_t>(double(raw) * bytes_ / rawBytes_) > maxBytes_) {
+            full_ = true;
+            return false;
+        }
+
+        Entry e;
+        e.size = image.size();
+        e.imageType = image.type();
+        compressMat(image, e.image, table_);
+        if (!mask.empty()) compressMat(mask, e.mask, table_);
+
+        size_t cost = e.image.size() + e.mask.size();
+        if (bytes_ + cost > maxBytes_) {
+            full_ = true;
+            return false;
+        }
+        bytes_ += cost;
+        rawBytes_ += raw;
+        entries_.emplace(index, std::move(e));
+        return true;
+    }
+
+    // Décompresse la frame dans `image` / `mask` (buffers réutilisés si déjà à la bonne taille).
+    bool get(int index, cv::Mat& image, cv::Mat& mask) {
+        auto it = entries_.find(index);
+        if (it == entries_.end()) return false;
+        const Entry& e = it->second;
+
+        if (!decompressMat(e.image, e.size, e.imageType, image)) return false;
+        if (!e.mask.empty() && !decompressMat(e.mask, e.size, CV_8UC1, mask)) return false;
+        hits_++;
+        return true;
+    }
+
+    bool full() const { return full_; }
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t rawBytes() const { return rawBytes_; }
+    long long hits() const { return hits_; }
+
+private:
+    struct Entry {
+        cv::Size size;
+        int imageType = CV_8UC3;
+        std::vector<uint8_t> image;
+        std::vector<uint8_t> mask;
+    };
+
+    static void compressMat(const cv::Mat& m, std::vector<uint8_t>& out, lz::HashTable& table) {
+        cv::Mat c = m.isContinuous() ? m : m.clone();
+        lz::compress(c.ptr<uint8_t>(), c.total() * c.elemSize(), out, table);
+    }
+
+    static bool decompressMat(const std::vector<uint8_t>& in, cv::Size size, int type, cv::Mat& m) {
+        m.create(size, type);
+        if (!m.isContinuous()) return false;
+        return lz::decompress(in.data(), in.size(), m.ptr<uint8_t>(), m.total() * m.elemSize());
+    }
+
+    size_t maxBytes_;
+    size_t bytes_ = 0;
+    size_t rawBytes_ = 0;
+    long long hits_ = 0;
+    bool full_ = false;
+    std::unordered_map<int, Entry> entries_;
+    lz::HashTable table_;  // table de hachage de lz::compress, jamais effacée entre deux frames
+};
+
+// Met à zéro les pixels transparents : invisibles à la composition, ils
+// deviennent de longues plages nulles qui se compressent très bien.
+inline void clearTransparent(cv::Mat& image, const cv::Mat& mask) {
+    CV_Assert(image.type() == CV_8UC3 && mask.type() == CV_8UC1 && image.size() == mask.size());
+    for (int y = 0; y < image.rows; y++) {
+        uchar* p = image.ptr<uchar>(y);
+        const uchar* m = mask.ptr<uchar>(y);
+        for (int x = 0; x < image.cols; x++, p += 3) {
+            if (m[x] == 0) p[0] = p[1] = p[2] = 0;
+        }
+    }
+}
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,174 @@
+#ifndef FRAME_HASH_H
+#define FRAME_HASH_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+// Détection des frames d'overlay identiques (plans fixes, arrêts sur image),
+// pour ne pas refaire redimensionnement et chroma key à chaque frame.
+//
+// sampled() est une empreinte rapide sur une grille sous-échantillonnée
+// (une ligne sur 16, un mot de 8 octets sur 8) ; quand elle est égale à celle
+// de la frame précédente, full() calcule une empreinte sur tous les octets.
+// Une empreinte de 64 bits peut entrer en collision : avant toute
+// réutilisation, PreparedCache compare la frame source octet par octet à celle
+// qui a produit l'overlay préparé. Les rondes de mélange sont celles de xxHash64.
+
+namespace framehash {
+
+namespace detail {
+
+const uint64_t P1 = 11400714785074694791ULL;
+const uint64_t P2 = 14029467366897019727ULL;
+const uint64_t P3 = 1609587929392839161ULL;
+const uint64_t P4 = 9650029242287828579ULL;
+const uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t round(uint64_t acc, uint64_t v) {
+    acc += v * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= round(0, v);
+    return rotl(h, 27) * P1 + P4;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t read64(const uchar* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t seed(const cv::Mat& m) {
+    return mix(P5, (static_cast<uint64_t>(m.cols) << 32) ^ (static_cast<uint64_t>(m.rows) << 8) ^
+                   static_cast<uint64_t>(m.type()));
+}
+
+inline uint64_t hashRows(const cv::Mat& m, int rowStep, size_t wordStep) {
+    uint64_t h = seed(m);
+    const size_t rowBytes = m.cols * m.elemSize();
+    for (int y = 0; y < m.rows; y += rowStep) {
+        const uchar* p = m.ptr<uchar>(y);
+        size_t x = 0;
+        for (; x + 8 <= rowBytes; x += 8 * wordStep) h = mix(h, read64(p + x));
+        if (wordStep == 1) {
+            for (; x < rowBytes; x++) h = mix(h, p[x]);
+        }
+    }
+    return avalanche(h);
+}
+
+} // namespace detail
+
+// Empreinte rapide (grille sous-échantillonnée) : égalité nécessaire, pas suffisante.
+inline uint64_t sampled(const cv::Mat& m) {
+    return detail::hashRows(m, 16, 8);
+}
+
+// Empreinte sur tous les octets ; jamais 0 (0 = « pas d'empreinte »). Égalité
+// nécessaire mais pas suffisante : à confirmer avec equal().
+inline uint64_t full(const cv::Mat& m) {
+    uint64_t h = detail::hashRows(m, 1, 1);
+    return h ? h : 1;
+}
+
+// Contenus identiques octet par octet (taille et type compris)
+inline bool equal(const cv::Mat& a, const cv::Mat& b) {
+    if (a.size() != b.size() || a.type() != b.type()) return false;
+    const size_t rowBytes = a.cols * a.elemSize();
+    for (int y = 0; y < a.rows; y++) {
+        if (std::memcmp(a.ptr<uchar>(y), b.ptr<uchar>(y), rowBytes) != 0) return false;
+    }
+    return true;
+}
+
+// Overlay préparé (redimensionné et détouré), jamais modifié une fois publié
+struct Prepared {
+    cv::Mat source;  // frame brute qui l'a produit (confirmation des empreintes)
+    cv::Mat image;
+    cv::Mat mask;    // vide sans chroma key
+};
+
+typedef std::shared_ptr<const Prepared> PreparedPtr;
+
+// Dernier overlay préparé d'une couche, partagé par les workers et identifié
+// par l'empreinte de la frame source, confirmée par comparaison des octets.
+//
+// Le verrou ne protège que l'échange de pointeur : lookup() rend une référence
+// partagée sur un instantané immuable, lu ensuite sans copie ni verrou. store()
+// publie un nouvel instantané ; les workers qui lisent encore l'ancien le
+// gardent vivant jusqu'à ce qu'ils le relâchent.
+class PreparedCache {
+public:
+    // Instantané préparé si l'empreinte correspond et que `source` est
+    // identique à la frame qui l'a produit, nullptr sinon. La comparaison se
+    // fait hors verrou, sur l'instantané.
+    PreparedPtr lookup(uint64_t hash, const cv::Mat& source) {
+        lookups_++;
+        if (hash == 0) return PreparedPtr();
+        PreparedPtr p;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (hash != hash_) return PreparedPtr();
+            p = prepared_;
+        }
+        if (!equal(p->source, source)) {
+            collisions_++;
+            return PreparedPtr();
+        }
+        hits_++;
+        return p;
+    }
+
+    // Vrai si l'instantané courant porte déjà cette empreinte (inutile de stocker).
+    bool holds(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hash == hash_;
+    }
+
+    // `source` est une copie de la frame brute, prise avant tout détourage sur place.
+    void store(uint64_t hash, const cv::Mat& source, const cv::Mat& image, const cv::Mat& mask) {
+        if (holds(hash)) return;
+        // Copie hors verrou : une seule par contenu distinct
+        std::shared_ptr<Prepared> p = std::make_shared<Prepared>();
+        p->source = source;
+        image.copyTo(p->image);
+        if (!mask.empty()) mask.copyTo(p->mask);
+        std::lock_guard<std::mutex> lock(mutex_);
+        prepared_ = std::move(p);
+        hash_ = hash;
+    }
+
+    long long hits() const { return hits_.load(); }
+    long long lookups() const { return lookups_.load(); }
+    long long collisions() const { return collisions_.load(); }
+
+private:
+    std::mutex mutex_;
+    uint64_t hash_ = 0;
+    PreparedPtr prepared_;
+    std::atomic<long long> hits_{0};
+    std::atomic<long long> lookups_{0};
+    std::atomic<long long> collisions_{0};
+};
+
+} // namespace framehash
+
+#endif // FRAME_HASH_H
@@ -0,0 +1,86 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Réutilisation des buffers image pour une boucle sans allocation en régime
+// établi, et compteur global des allocations de buffers image du pipeline.
+//
+// Le compteur ne voit que les cv::Mat passés à trackBufferAllocation() : les
+// allocations du tas hors buffers image (files, nœuds de la remise en ordre,
+// SharedFrame des sorties...) ne sont pas comptées.
+
+namespace framepool {
+
+inline std::atomic<long long>& bufferAllocationCounter() {
+    static std::atomic<long long> counter(0);
+    return counter;
+}
+
+inline long long bufferAllocations() { return bufferAllocationCounter().load(); }
+
+// À appeler après une opération OpenCV écrivant dans `m` (read, resize, create...) :
+// si le buffer a changé, c'est que l'opération a (ré)alloué.
+inline void trackBufferAllocation(const uchar* dataBefore, const cv::Mat& m) {
+    if (m.data && m.data != dataBefore) bufferAllocationCounter()++;
+}
+
+// Alloue `m` si nécessaire, sans rien faire si la taille et le type conviennent déjà.
+inline void ensure(cv::Mat& m, cv::Size size, int type) {
+    const uchar* before = m.data;
+    m.create(size, type);
+    trackBufferAllocation(before, m);
+}
+
+// Réserve de frames de taille fixe. acquire() bloque quand les `capacity`
+// buffers sont tous en circulation, ce qui sert aussi de contre-pression.
+// Les buffers sont créés à la demande (warm-up) puis recyclés indéfiniment.
+class FramePool {
+public:
+    FramePool(cv::Size size, int type, size_t capacity)
+        : size_(size), type_(type), capacity_(capacity ? capacity : 1) {
+        free_.reserve(capacity_);
+    }
+
+    cv::Mat acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        available_.wait(lock, [&] { return !free_.empty() || created_ < capacity_; });
+        if (!free_.empty()) {
+            cv::Mat m = free_.back();
+            free_.pop_back();
+            return m;
+        }
+        created_++;
+        lock.unlock();
+        cv::Mat m;
+        ensure(m, size_, type_);
+        return m;
+    }
+
+    void release(cv::Mat m) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (m.empty()) {
+            created_--;  // buffer perdu (ex. lecture échouée), sera recréé
+        } else {
+            free_.push_back(m);
+        }
+        available_.notify_one();
+    }
+
+private:
+    cv::Size size_;
+    int type_;
+    size_t capacity_;
+    size_t created_ = 0;
+    std::vector<cv::Mat> free_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+};
+
+} // namespace framepool
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,149 @@
+#ifndef LUT_KEYER_H
+#define LUT_KEYER_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Chroma key précompilé en table 3D.
+//
+// Le modèle de clé est évalué en YCbCr (BT.601, pleine échelle) :
+//   d = sqrt((Cb-kCb)^2 + (Cr-kCr)^2 + (w*(Y-kY))^2)
+//   alpha = 0 si d < tolerance, rampe linéaire sur `softness`, puis 255
+// et la suppression du débordement (despill) retire de la chrominance la
+// composante dirigée vers la couleur de clé, à luminance constante.
+//
+// Ce modèle n'est calculé qu'une fois, au centre de chaque cellule d'une grille
+// 64x64x64 indexée directement par les 6 bits de poids fort de B, G et R :
+// chaque entrée contient l'alpha et la correction de despill (delta BGR).
+// Par pixel, le coût est une seule lecture dans la table (1 Mo), quel que soit
+// le modèle de clé. Les frames arrivant en BGR, indexer la table en BGR évite
+// la conversion YCbCr par pixel.
+
+namespace chroma {
+
+struct LutKeyParams {
+    cv::Vec3b key = cv::Vec3b(0, 255, 0);
+    int tolerance = 40;       // rayon entièrement transparent (distance YCbCr)
+    int softness = 0;         // largeur de la rampe, 0 = masque binaire
+    float despill = 1.f;      // 0 = aucune correction, 1 = suppression complète
+    float lumaWeight = 0.25f; // poids de la luminance dans la distance
+};
+
+class LutKeyer {
+public:
+    static const int kBits = 6;
+    static const int kSize = 1 << kBits;
+    static const int kShift = 8 - kBits;
+
+    bool empty() const { return lut_.empty(); }
+    bool despill() const { return despill_; }
+
+    // Compile les paramètres dans la table ; à appeler une fois avant apply().
+    void build(const LutKeyParams& p) {
+        lut_.assign(static_cast<size_t>(kSize) * kSize * kSize, Entry());
+        despill_ = p.despill > 0.f;
+
+        float kY, kCb, kCr;
+        toYCbCr(p.key[0], p.key[1], p.key[2], kY, kCb, kCr);
+        // Direction de la clé dans le plan de chrominance
+        float dirCb = kCb - 128.f, dirCr = kCr - 128.f;
+        float norm = std::sqrt(dirCb * dirCb + dirCr * dirCr);
+        if (norm < 1.f) {
+            despill_ = false;  // clé neutre (gris) : rien à retirer
+        } else {
+            dirCb /= norm;
+            dirCr /= norm;
+        }
+
+        const float step = static_cast<float>(1 << kShift);
+        const float center = (step - 1.f) * 0.5f;
+        for (int bi = 0; bi < kSize; bi++) {
+            for (int gi = 0; gi < kSize; gi++) {
+                for (int ri = 0; ri < kSize; ri++) {
+                    float b = bi * step + center, g = gi * step + center, r = ri * step + center;
+                    float y, cb, cr;
+                    toYCbCr(b, g, r, y, cb, cr);
+
+                    Entry& e = lut_[index(bi, gi, ri)];
+                    float dy = p.lumaWeight * (y - kY);
+                    float d = std::sqrt((cb - kCb) * (cb - kCb) + (cr - kCr) * (cr - kCr) + dy * dy);
+                    if (p.softness <= 0) {
+                        e.alpha = d < p.tolerance ? 0 : 255;
+                    } else {
+                        float a = (d - p.tolerance) / p.softness;
+                        e.alpha = static_cast<uchar>(cvRound(std::min(std::max(a, 0.f), 1.f) * 255.f));
+                    }
+
+                    if (despill_) {
+                        float spill = (cb - 128.f) * dirCb + (cr - 128.f) * dirCr;
+                        if (spill > 0.f) {
+                            spill *= p.despill;
+                            float nb, ng, nr;
+                            fromYCbCr(y, cb - spill * dirCb, cr - spill * dirCr, nb, ng, nr);
+                            e.db = delta(nb - b);
+                            e.dg = delta(ng - g);
+                            e.dr = delta(nr - r);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Masque alpha de `bgr` ; avec despill, les couleurs de `bgr` sont corrigées sur place.
+    void apply(cv::Mat& bgr, cv::Mat& alpha) const {
+        CV_Assert(!empty() && bgr.type() == CV_8UC3);
+        alpha.create(bgr.size(), CV_8UC1);
+        const Entry* lut = lut_.data();
+        for (int y = 0; y < bgr.rows; y++) {
+            uchar* p = bgr.ptr<uchar>(y);
+            uchar* a = alpha.ptr<uchar>(y);
+            if (despill_) {
+                for (int x = 0; x < bgr.cols; x++, p += 3) {
+                    const Entry& e = lut[index(p[0] >> kShift, p[1] >> kShift, p[2] >> kShift)];
+                    a[x] = e.alpha;
+                    p[0] = cv::saturate_cast<uchar>(p[0] + e.db);
+                    p[1] = cv::saturate_cast<uchar>(p[1] + e.dg);
+                    p[2] = cv::saturate_cast<uchar>(p[2] + e.dr);
+                }
+            } else {
+                for (int x = 0; x < bgr.cols; x++, p += 3) {
+                    a[x] = lut[index(p[0] >> kShift, p[1] >> kShift, p[2] >> kShift)].alpha;
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        uchar alpha = 255;
+        schar db = 0, dg = 0, dr = 0;  // correction de despill
+    };
+
+    static int index(int b, int g, int r) { return (b << (2 * kBits)) | (g << kBits) | r; }
+
+    static schar delta(float v) {
+        return static_cast<schar>(std::min(std::max(cvRound(v), -127), 127));
+    }
+
+    static void toYCbCr(float b, float g, float r, float& y, float& cb, float& cr) {
+        y = 0.299f * r + 0.587f * g + 0.114f * b;
+        cb = 128.f + 0.564f * (b - y);
+        cr = 128.f + 0.713f * (r - y);
+    }
+
+    static void fromYCbCr(float y, float cb, float cr, float& b, float& g, float& r) {
+        r = y + 1.403f * (cr - 128.f);
+        b = y + 1.773f * (cb - 128.f);
+        g = (y - 0.299f * r - 0.114f * b) / 0.587f;
+    }
+
+    std::vector<Entry> lut_;
+    bool despill_ = false;
+};
+
+} // namespace chroma
+
+#endif // LUT_KEYER_H
@@ -0,0 +1,155 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Compression LZ77 rapide au format de bloc « façon LZ4 » : une suite de
+// séquences [token][littéraux][offset 16 bits][longueur de match], le token
+// codant sur 4 bits la longueur des littéraux et celle du match (minimum 4),
+// avec extensions par octets 255. La dernière séquence n'a que des littéraux.
+//
+// Pas de dépendance externe : suffisant pour les frames d'overlay détourées,
+// qui contiennent surtout de grandes zones uniformes.
+
+namespace lz {
+
+namespace detail {
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - 16);
+}
+
+inline void writeLength(std::vector<uint8_t>& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(len));
+}
+
+inline void emitSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen,
+                         size_t offset, size_t matchLen) {
+    size_t ml = matchLen ? matchLen - 4 : 0;
+    uint8_t token = static_cast<uint8_t>((litLen >= 15 ? 15 : litLen) << 4);
+    token |= static_cast<uint8_t>(ml >= 15 ? 15 : ml);
+    out.push_back(token);
+    if (litLen >= 15) writeLength(out, litLen - 15);
+    out.insert(out.end(), literals, literals + litLen);
+    if (matchLen) {
+        out.push_back(static_cast<uint8_t>(offset & 0xFF));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (ml >= 15) writeLength(out, ml - 15);
+    }
+}
+
+} // namespace detail
+
+// Table de hachage de compress() (256 Ko), gardée par l'appelant d'un appel à
+// l'autre sans remise à zéro : les positions y sont décalées de `base`, qui
+// avance de la taille de chaque bloc compressé. Une valeur <= base vient donc
+// d'un bloc précédent et est ignorée ; la table n'est effacée qu'au débordement
+// de la base (tous les ~4 Go compressés).
+struct HashTable {
+    std::vector<uint32_t> slots;
+    uint32_t base = 0;
+};
+
+// Compresse `src` (n octets) dans `out` (remplacé).
+inline void compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out, HashTable& table) {
+    out.clear();
+    out.reserve(n / 4 + 16);
+
+    const size_t kMinMatch = 4;
+    const size_t kMaxOffset = 65535;
+    if (table.slots.empty() || n >= UINT32_MAX - table.base) {
+        table.slots.assign(1 << 16, 0);
+        table.base = 0;
+    }
+    const uint32_t base = table.base;  // position + 1 + base ; <= base = vide
+
+    size_t ip = 0, anchor = 0;
+    const size_t limit = n > 12 ? n - 12 : 0;
+
+    while (ip < limit) {
+        uint32_t seq = detail::read32(src + ip);
+        uint32_t h = detail::hash32(seq);
+        size_t ref = table.slots[h];
+        table.slots[h] = static_cast<uint32_t>(base + ip + 1);
+
+        if (ref > base && ip - (ref - base - 1) <= kMaxOffset && detail::read32(src + ref - base - 1) == seq) {
+            ref -= base + 1;
+            size_t len = kMinMatch;
+            while (ip + len < n && src[ref + len] == src[ip + len]) len++;
+            detail::emitSequence(out, src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+        } else {
+            // Accélération dans les zones incompressibles
+            ip += 1 + ((ip - anchor) >> 6);
+        }
+    }
+    detail::emitSequence(out, src + anchor, n - anchor, 0, 0);
+    table.base = static_cast<uint32_t>(base + n + 1);
+}
+
+// Décompresse `src` (n octets) vers `dst` de taille exacte `dstSize`.
+// Retourne false si le flux est corrompu ou de taille inattendue.
+inline bool decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + n;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dstSize;
+
+    auto readLength = [&](size_t& len) {
+        uint8_t b;
+        do {
+            if (ip >= iend) return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !readLength(lit)) return false;
+        if (lit > static_cast<size_t>(iend - ip) || lit > static_cast<size_t>(oend - op)) return false;
+        std::memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip >= iend) break;  // dernière séquence : littéraux seuls
+
+        if (iend - ip < 2) return false;
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !readLength(len)) return false;
+        len += 4;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) ||
+            len > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        const uint8_t* match = op - offset;
+        if (offset >= len) {
+            std::memcpy(op, match, len);
+            op += len;
+        } else {
+            // Recouvrement (répétition courte) : copie octet par octet
+            for (size_t i = 0; i < len; i++) *op++ = *match++;
+        }
+    }
+    return op == oend;
+}
+
+} // namespace lz
+
+#endif // LZ_CODEC_H
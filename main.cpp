@@ -1,18 +1,44 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "overlay_reader.h"
+#include "chroma_key.h"
+#include "lut_keyer.h"
+#include "matte_refine.h"
+#include "composite.h"
+#include "blend.h"
+#include "pip_style.h"
+#include "pipeline.h"
+#include "frame_pool.h"
+#include "timeline.h"
+#include "frame_cache.h"
+#include "frame_hash.h"
+#include "motion.h"
+#include "mosaic.h"
+#include "media_probe.h"
+#include "rendition.h"
 
 using namespace cv;
 using namespace std;
+using json = nlohmann::json;
 
 enum class Position { TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT, CENTER, CUSTOM };
 enum class TimeAlign { START, END, FRAME, TIMESTAMP };
+enum class Playback { ONCE, LOOP, PINGPONG };
 
-struct Config {
-    string mainVideo;
-    string overlayVideo;
-    string outputVideo;
+// Paramètres d'un overlay : ligne de commande ou entrée de la timeline JSON
+struct LayerConfig {
+    string video;
     Position position = Position::TOP_LEFT;
     int customX = 0;
     int customY = 0;
@@ -22,15 +48,56 @@ struct Config {
     Vec3b chromaKey = Vec3b(0, 255, 0); // Vert par défaut
     bool useChromaKey = false;
     int chromaTolerance = 40;
+    int chromaSoftness = 0; // 0 = masque binaire
+    bool lutKeyer = false;  // keyer YCbCr précompilé en table 3D (--keyer lut)
+    float despill = 1.f;    // suppression du débordement (keyer lut)
+    bool refineMatte = false;     // raffinement du masque par filtre guidé
+    matte::RefineParams refine;
     double overlayScale = 1.0;
+    int zOrder = 0;         // les z plus grands sont dessinés par-dessus
+    ResampleMode resample = ResampleMode::NEAREST; // si les fps diffèrent
+    Playback playback = Playback::ONCE;
+    motion::MotionPath motion;  // trajectoire animée (remplace la position si non vide)
+    bool alpha = false;         // overlay avec canal alpha (BGRA), sans chroma key
+    double trimIn = 0.0;        // extrait de l'overlay (secondes, temps de l'overlay)
+    double trimOut = -1.0;      // -1 = jusqu'à la fin
+    blend::Mode blendMode = blend::Mode::NORMAL;
+    pip::Style pipStyle;        // coins arrondis, bordure, ombre portée
+    int opacity = 255;          // 0..255
+    
+    // Masque tout ou rien : chroma key sans rampe douce ni raffinement
+    bool binaryMatte() const { return chromaSoftness == 0 && !refineMatte; }
+};
+
+struct Config {
+    string mainVideo;
+    string outputVideo;
+    vector<rendition::Spec> renditions;  // sorties supplémentaires (--rendition)
+    LayerConfig overlay;         // overlay de la ligne de commande (-o)
+    string timelineFile;         // timeline JSON (--timeline)
+    vector<LayerConfig> layers;  // tous les overlays à composer
+    int threads = 0;          // 0 = nombre de coeurs
+    int maxQueuedFrames = 0;  // 0 = 2 x threads
+    size_t cacheMB = 512;     // budget du cache compressé des overlays en boucle
+    bool frameHash = true;    // réutiliser l'overlay préparé des frames identiques
+    bool assertNoBufferAlloc = false;
+    bool benchChroma = false;
+    bool benchBlend = false;
+    string mosaicGrid;           // mode mosaïque (--mosaic), vide = incrustation
+    vector<string> mosaicInputs; // vidéos de la mosaïque (-i)
+    Size mosaicSize;             // taille de sortie de la mosaïque
 };
 
 void printUsage(const char* progName) {
     cout << "Usage: " << progName << " [options]\n"
          << "Options:\n"
          << "  -m, --main <file>          Video principale (requise)\n"
-         << "  -o, --overlay <file>       Video d'incrustation (requise)\n"
+         << "  -o, --overlay <file>       Video d'incrustation (requise sans --timeline)\n"
+         << "  --timeline <file.json>     Liste d'overlays à composer en une seule passe\n"
          << "  -out, --output <file>      Video de sortie (défaut: output.avi)\n"
+         << "  --rendition <spec>         Sortie supplémentaire de la même composition (répétable):\n"
+         << "                             fichier[:LxH[:fourcc]], ex: out_720.mp4:1280x720:avc1\n"
+         << "                             (une dimension à 0 suit le ratio, fourcc par défaut MJPG)\n"
          << "  -p, --position <pos>       Position: topleft|topright|bottomleft|bottomright|center|custom\n"
          << "  -x <pixels>                Position X personnalisée (avec --position custom)\n"
          << "  -y <pixels>                Position Y personnalisée (avec --position custom)\n"
@@ -39,17 +106,316 @@ void printUsage(const char* progName) {
          << "  -ts, --timestamp <sec>     Timestamp de début en secondes (avec --align timestamp)\n"
          << "  -c, --chroma <r,g,b>       Activer chroma key avec couleur RGB (ex: 0,255,0 pour vert)\n"
          << "  -t, --tolerance <val>      Tolérance du chroma key (défaut: 40)\n"
+         << "  -sf, --softness <val>      Largeur de la rampe douce du chroma key (défaut: 0 = binaire)\n"
+         << "  --keyer <l1|lut>           Modèle du chroma key: distance BGR (l1) ou table 3D YCbCr (lut)\n"
+         << "  --refine-matte             Affiner les bords du masque (filtre guidé à 1/4 de résolution)\n"
+         << "  --refine-radius <px>       Rayon du raffinement en pixels (défaut: 8)\n"
+         << "  --despill <0..1>           Suppression du débordement de couleur (keyer lut, défaut: 1)\n"
+         << "  --alpha                    Overlay avec canal alpha (séquence PNG, MOV PNG/QTRLE, FFV1, WebM VP9)\n"
          << "  -s, --scale <float>        Échelle de la vidéo overlay (défaut: 1.0)\n"
+         << "  --trim <in>:<out>          N'utiliser que l'extrait [in, out] de l'overlay (secondes, out optionnel)\n"
+         << "  --blend <mode>             Mode de fusion: normal|multiply|screen|add|overlay (défaut: normal)\n"
+         << "  --opacity <0..1>           Opacité de l'overlay (défaut: 1)\n"
+         << "  --pip-radius <px>          Coins arrondis de l'overlay (rayon en pixels)\n"
+         << "  --pip-border <px>          Bordure autour de l'overlay (épaisseur en pixels)\n"
+         << "  --pip-border-color <r,g,b> Couleur de la bordure (défaut: 255,255,255)\n"
+         << "  --pip-shadow <px>          Ombre portée floutée (rayon du flou en pixels)\n"
+         << "  --pip-shadow-offset <dx,dy> Décalage de l'ombre (défaut: 6,6)\n"
+         << "  --pip-shadow-opacity <0..1> Opacité de l'ombre (défaut: 0.5)\n"
+         << "  --motion <keys>            Trajectoire animée: \"t:x,y[,scale[,easing]];...\" (t en s)\n"
+         << "  -z, --z-order <n>          Ordre d'empilement de l'overlay (défaut: 0)\n"
+         << "  --resample <mode>          Si les fps diffèrent: nearest (répète/saute) | blend (mélange)\n"
+         << "  --playback <mode>          Lecture de l'overlay: once|loop|pingpong (défaut: once)\n"
+         << "  --cache-mb <n>             Mémoire max du cache des overlays en boucle (défaut: 512)\n"
+         << "  --no-frame-hash            Ne pas détecter les frames d'overlay identiques\n"
+         << "  -j, --threads <n>          Nombre de threads de composition (défaut: nombre de coeurs)\n"
+         << "  --queue <n>                Frames max en attente par étage du pipeline (défaut: 2 x threads)\n"
+         << "  --assert-no-buffer-alloc   Échouer si des buffers image sont alloués après le warm-up\n"
+         << "  --bench-chroma             Mesurer le débit du chroma key (scalaire / SIMD)\n"
+         << "  --bench-blend              Mesurer le débit des modes de fusion (scalaire / SIMD / copie)\n"
+         << "  --mosaic <grid>            Mode mosaïque: grille colsxrows (ex: 3x3) ou auto\n"
+         << "  -i, --input <file>         Vidéo de la mosaïque (répétable, ordre de lecture)\n"
+         << "  --mosaic-size <WxH>        Taille de sortie de la mosaïque (défaut: 1re vidéo)\n"
          << "  -h, --help                 Afficher cette aide\n"
          << "\n"
          << "Exemples d'alignement temporel:\n"
          << "  start       : Overlay commence au début de la vidéo principale\n"
          << "  end         : Overlay se termine avec la fin de la vidéo principale\n"
          << "  frame       : Overlay commence à une frame spécifique (-f)\n"
-         << "  timestamp   : Overlay commence à un timestamp spécifique (-ts)\n";
+         << "  timestamp   : Overlay commence à un timestamp spécifique (-ts)\n"
+         << "\n"
+         << "Timeline JSON (--timeline):\n"
+         << "  { \"overlays\": [ { \"file\": \"pip.mp4\", \"position\": \"topright\", \"x\": 0, \"y\": 0,\n"
+         << "                    \"align\": \"timestamp\", \"frame\": 0, \"timestamp\": 5.0,\n"
+         << "                    \"scale\": 0.5, \"chroma\": \"0,255,0\", \"tolerance\": 40,\n"
+         << "                    \"softness\": 0, \"keyer\": \"lut\", \"despill\": 1.0,\n"
+         << "                    \"refine\": true, \"refineRadius\": 8, \"z\": 1, \"resample\": \"nearest\",\n"
+         << "                    \"playback\": \"once\", \"alpha\": false,\n"
+         << "                    \"blend\": \"screen\", \"opacity\": 0.8, \"in\": 12.0, \"out\": 20.0,\n"
+         << "                    \"pip\": { \"radius\": 16, \"border\": 4, \"borderColor\": \"255,255,255\",\n"
+         << "                             \"shadow\": 12, \"shadowOffset\": [6, 6], \"shadowOpacity\": 0.5 },\n"
+         << "                    \"motion\": [ { \"t\": 0, \"x\": -320, \"y\": 40 },\n"
+         << "                                { \"t\": 1.5, \"x\": 40, \"y\": 40, \"scale\": 1.0,\n"
+         << "                                  \"easing\": \"ease-out\" } ] } ] }\n"
+         << "  L'easing d'une keyframe s'applique jusqu'à la keyframe suivante.\n";
+}
+
+bool parsePosition(string pos, Position& out) {
+    transform(pos.begin(), pos.end(), pos.begin(), ::tolower);
+    if (pos == "topleft") out = Position::TOP_LEFT;
+    else if (pos == "topright") out = Position::TOP_RIGHT;
+    else if (pos == "bottomleft") out = Position::BOTTOM_LEFT;
+    else if (pos == "bottomright") out = Position::BOTTOM_RIGHT;
+    else if (pos == "center") out = Position::CENTER;
+    else if (pos == "custom") out = Position::CUSTOM;
+    else return false;
+    return true;
+}
+
+bool parseResampleMode(string mode, ResampleMode& out) {
+    transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if (mode == "nearest") out = ResampleMode::NEAREST;
+    else if (mode == "blend") out = ResampleMode::BLEND;
+    else return false;
+    return true;
+}
+
+bool parseKeyer(string keyer, bool& lut) {
+    transform(keyer.begin(), keyer.end(), keyer.begin(), ::tolower);
+    if (keyer == "l1") lut = false;
+    else if (keyer == "lut") lut = true;
+    else return false;
+    return true;
+}
+
+bool parsePlayback(string mode, Playback& out) {
+    transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if (mode == "once") out = Playback::ONCE;
+    else if (mode == "loop") out = Playback::LOOP;
+    else if (mode == "pingpong") out = Playback::PINGPONG;
+    else return false;
+    return true;
+}
+
+bool parseBlendMode(string mode, blend::Mode& out) {
+    transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if (mode == "normal") out = blend::Mode::NORMAL;
+    else if (mode == "multiply") out = blend::Mode::MULTIPLY;
+    else if (mode == "screen") out = blend::Mode::SCREEN;
+    else if (mode == "add") out = blend::Mode::ADD;
+    else if (mode == "overlay") out = blend::Mode::OVERLAY;
+    else return false;
+    return true;
+}
+
+// Opacité 0..1 -> 0..255
+int parseOpacity(double opacity) {
+    return cvRound(min(max(opacity, 0.0), 1.0) * 255.0);
+}
+
+bool parseTimeAlign(string align, TimeAlign& out) {
+    transform(align.begin(), align.end(), align.begin(), ::tolower);
+    if (align == "start") out = TimeAlign::START;
+    else if (align == "end") out = TimeAlign::END;
+    else if (align == "frame") out = TimeAlign::FRAME;
+    else if (align == "timestamp") out = TimeAlign::TIMESTAMP;
+    else return false;
+    return true;
+}
+
+// Extrait "in:out" en secondes ; "12:" = de 12 s jusqu'à la fin
+bool parseTrim(const string& text, double& in, double& out) {
+    size_t colon = text.find(':');
+    if (colon == string::npos) return false;
+    try {
+        in = colon > 0 ? stod(text.substr(0, colon)) : 0.0;
+        out = colon + 1 < text.size() ? stod(text.substr(colon + 1)) : -1.0;
+    } catch (const exception&) {
+        return false;
+    }
+    return in >= 0.0 && (out < 0.0 || out > in);
+}
+
+// Décalage "dx,dy" en pixels
+bool parseOffset(const string& text, Point& out) {
+    int dx = 0, dy = 0;
+    if (sscanf(text.c_str(), "%d,%d", &dx, &dy) != 2) return false;
+    out = Point(dx, dy);
+    return true;
+}
+
+// Couleur "r,g,b" -> Vec3b BGR
+bool parseChromaColor(const string& color, Vec3b& out) {
+    size_t pos1 = color.find(',');
+    size_t pos2 = color.find(',', pos1 + 1);
+    if (pos1 == string::npos || pos2 == string::npos) return false;
+    out[2] = stoi(color.substr(0, pos1)); // R
+    out[1] = stoi(color.substr(pos1 + 1, pos2 - pos1 - 1)); // G
+    out[0] = stoi(color.substr(pos2 + 1)); // B
+    return true;
+}
+
+// Lit une entrée de la timeline ; les champs mal typés lèvent json::exception
+bool parseTimelineEntry(const json& it, LayerConfig& l) {
+    l.video = it.value("file", string());
+    if (l.video.empty()) {
+        cerr << "Erreur: entrée de timeline sans \"file\"\n";
+        return false;
+    }
+    if (it.contains("position") && !parsePosition(it["position"].get<string>(), l.position)) {
+        cerr << "Position invalide dans la timeline: " << it["position"] << endl;
+        return false;
+    }
+    l.customX = it.value("x", 0);
+    l.customY = it.value("y", 0);
+    // Comme en ligne de commande, "frame" / "timestamp" impliquent l'alignement
+    if (it.contains("frame")) {
+        l.startFrame = it["frame"].get<int>();
+        l.timeAlign = TimeAlign::FRAME;
+    }
+    if (it.contains("timestamp")) {
+        l.startTimestamp = it["timestamp"].get<double>();
+        l.timeAlign = TimeAlign::TIMESTAMP;
+    }
+    if (it.contains("align") && !parseTimeAlign(it["align"].get<string>(), l.timeAlign)) {
+        cerr << "Alignement invalide dans la timeline: " << it["align"] << endl;
+        return false;
+    }
+    l.overlayScale = it.value("scale", 1.0);
+    if (it.contains("chroma")) {
+        const json& c = it["chroma"];
+        l.useChromaKey = true;
+        if (c.is_string()) {
+            if (!parseChromaColor(c.get<string>(), l.chromaKey)) {
+                cerr << "Couleur de chroma invalide dans la timeline: " << c << endl;
+                return false;
+            }
+        } else if (c.is_array() && c.size() == 3) {
+            l.chromaKey = Vec3b(c[2].get<int>(), c[1].get<int>(), c[0].get<int>());
+        } else {
+            cerr << "Couleur de chroma invalide dans la timeline: " << c << endl;
+            return false;
+        }
+    }
+    l.chromaTolerance = it.value("tolerance", 40);
+    l.chromaSoftness = max(0, it.value("softness", 0));
+    if (it.contains("keyer") && !parseKeyer(it["keyer"].get<string>(), l.lutKeyer)) {
+        cerr << "Keyer invalide dans la timeline: " << it["keyer"] << endl;
+        return false;
+    }
+    l.despill = min(max(it.value("despill", 1.0f), 0.f), 1.f);
+    l.refineMatte = it.value("refine", false);
+    l.refine.radius = max(1, it.value("refineRadius", l.refine.radius));
+    l.zOrder = it.value("z", 0);
+    if (it.contains("resample") && !parseResampleMode(it["resample"].get<string>(), l.resample)) {
+        cerr << "Mode de rééchantillonnage invalide dans la timeline: " << it["resample"] << endl;
+        return false;
+    }
+    if (it.contains("playback") && !parsePlayback(it["playback"].get<string>(), l.playback)) {
+        cerr << "Mode de lecture invalide dans la timeline: " << it["playback"] << endl;
+        return false;
+    }
+    l.alpha = it.value("alpha", false);
+    if (it.contains("blend") && !parseBlendMode(it["blend"].get<string>(), l.blendMode)) {
+        cerr << "Mode de fusion invalide dans la timeline: " << it["blend"] << endl;
+        return false;
+    }
+    l.opacity = parseOpacity(it.value("opacity", 1.0));
+    if (it.contains("pip")) {
+        const json& st = it["pip"];
+        pip::Style& ps = l.pipStyle;
+        ps.radius = max(0, st.value("radius", 0));
+        ps.border = max(0, st.value("border", 0));
+        ps.shadow = max(0, st.value("shadow", 0));
+        ps.shadowOpacity = st.value("shadowOpacity", ps.shadowOpacity);
+        if (st.contains("borderColor") && !parseChromaColor(st["borderColor"].get<string>(), ps.borderColor)) {
+            cerr << "Couleur de bordure invalide dans la timeline: " << st["borderColor"] << endl;
+            return false;
+        }
+        if (st.contains("shadowOffset")) {
+            const json& o = st["shadowOffset"];
+            if (!o.is_array() || o.size() != 2) {
+                cerr << "Décalage d'ombre invalide dans la timeline: " << o << endl;
+                return false;
+            }
+            ps.shadowOffset = Point(o[0].get<int>(), o[1].get<int>());
+        }
+    }
+    l.trimIn = max(0.0, it.value("in", 0.0));
+    l.trimOut = it.value("out", -1.0);
+    if (l.trimOut >= 0.0 && l.trimOut <= l.trimIn) {
+        cerr << "Extrait invalide dans la timeline: in " << l.trimIn << ", out " << l.trimOut << endl;
+        return false;
+    }
+    if (it.contains("motion")) {
+        const json& m = it["motion"];
+        bool ok = true;
+        if (m.is_string()) {
+            ok = motion::parsePath(m.get<string>(), l.motion);
+        } else if (m.is_array()) {
+            for (const auto& k : m) {
+                motion::Keyframe key;
+                key.time = k.value("t", 0.0);
+                key.x = k.value("x", 0.0);
+                key.y = k.value("y", 0.0);
+                key.scale = k.value("scale", 1.0);
+                if (!Easing::parse(k.value("easing", string("linear")), key.easing)) ok = false;
+                if (key.scale <= 0) ok = false;
+                l.motion.add(key);
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            cerr << "Trajectoire invalide dans la timeline: " << m << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Charge les overlays d'une timeline JSON : objet {"overlays": [...]} ou tableau
+bool loadTimeline(const string& path, vector<LayerConfig>& layers) {
+    ifstream f(path);
+    if (!f.is_open()) {
+        cerr << "Erreur: Impossible d'ouvrir la timeline: " << path << endl;
+        return false;
+    }
+    
+    json j;
+    try {
+        f >> j;
+    } catch (const exception& e) {
+        cerr << "Erreur JSON (" << path << "): " << e.what() << endl;
+        return false;
+    }
+    
+    json list;
+    try {
+        list = j.is_array() ? j : j.value("overlays", json::array());
+    } catch (const json::exception& e) {
+        cerr << "Erreur JSON (" << path << "): " << e.what() << endl;
+        return false;
+    }
+    for (size_t i = 0; i < list.size(); i++) {
+        LayerConfig l;
+        try {
+            if (!parseTimelineEntry(list[i], l)) {
+                cerr << "  (entrée " << i << " de la timeline " << path << ")\n";
+                return false;
+            }
+        } catch (const json::exception& e) {
+            cerr << "Erreur dans l'entrée " << i << " de la timeline (" << path << "): " << e.what() << endl;
+            return false;
+        }
+        layers.push_back(l);
+    }
+    return true;
 }
 
 bool parseArgs(int argc, char** argv, Config& cfg) {
+    LayerConfig& ov = cfg.overlay;
+    
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
         
@@ -61,63 +427,184 @@ bool parseArgs(int argc, char** argv, Config& cfg) {
             cfg.mainVideo = argv[++i];
         }
         else if ((arg == "-o" || arg == "--overlay") && i + 1 < argc) {
-            cfg.overlayVideo = argv[++i];
+            ov.video = argv[++i];
+        }
+        else if (arg == "--timeline" && i + 1 < argc) {
+            cfg.timelineFile = argv[++i];
         }
         else if ((arg == "-out" || arg == "--output") && i + 1 < argc) {
             cfg.outputVideo = argv[++i];
         }
+        else if (arg == "--rendition" && i + 1 < argc) {
+            rendition::Spec spec;
+            if (!rendition::parseSpec(argv[++i], spec)) {
+                cerr << "Erreur: Sortie invalide: " << argv[i] << endl;
+                return false;
+            }
+            cfg.renditions.push_back(spec);
+        }
         else if ((arg == "-p" || arg == "--position") && i + 1 < argc) {
-            string pos = argv[++i];
-            transform(pos.begin(), pos.end(), pos.begin(), ::tolower);
-            if (pos == "topleft") cfg.position = Position::TOP_LEFT;
-            else if (pos == "topright") cfg.position = Position::TOP_RIGHT;
-            else if (pos == "bottomleft") cfg.position = Position::BOTTOM_LEFT;
-            else if (pos == "bottomright") cfg.position = Position::BOTTOM_RIGHT;
-            else if (pos == "center") cfg.position = Position::CENTER;
-            else if (pos == "custom") cfg.position = Position::CUSTOM;
+            parsePosition(argv[++i], ov.position);
         }
         else if (arg == "-x" && i + 1 < argc) {
-            cfg.customX = stoi(argv[++i]);
+            ov.customX = stoi(argv[++i]);
         }
         else if (arg == "-y" && i + 1 < argc) {
-            cfg.customY = stoi(argv[++i]);
+            ov.customY = stoi(argv[++i]);
         }
         else if ((arg == "-a" || arg == "--align") && i + 1 < argc) {
-            string align = argv[++i];
-            transform(align.begin(), align.end(), align.begin(), ::tolower);
-            if (align == "start") cfg.timeAlign = TimeAlign::START;
-            else if (align == "end") cfg.timeAlign = TimeAlign::END;
-            else if (align == "frame") cfg.timeAlign = TimeAlign::FRAME;
-            else if (align == "timestamp") cfg.timeAlign = TimeAlign::TIMESTAMP;
+            parseTimeAlign(argv[++i], ov.timeAlign);
         }
         else if ((arg == "-f" || arg == "--frame") && i + 1 < argc) {
-            cfg.startFrame = stoi(argv[++i]);
-            cfg.timeAlign = TimeAlign::FRAME;
+            ov.startFrame = stoi(argv[++i]);
+            ov.timeAlign = TimeAlign::FRAME;
         }
         else if ((arg == "-ts" || arg == "--timestamp") && i + 1 < argc) {
-            cfg.startTimestamp = stod(argv[++i]);
-            cfg.timeAlign = TimeAlign::TIMESTAMP;
+            ov.startTimestamp = stod(argv[++i]);
+            ov.timeAlign = TimeAlign::TIMESTAMP;
         }
         else if ((arg == "-c" || arg == "--chroma") && i + 1 < argc) {
-            cfg.useChromaKey = true;
-            string color = argv[++i];
-            size_t pos1 = color.find(',');
-            size_t pos2 = color.find(',', pos1 + 1);
-            if (pos1 != string::npos && pos2 != string::npos) {
-                cfg.chromaKey[2] = stoi(color.substr(0, pos1)); // R
-                cfg.chromaKey[1] = stoi(color.substr(pos1 + 1, pos2 - pos1 - 1)); // G
-                cfg.chromaKey[0] = stoi(color.substr(pos2 + 1)); // B
-            }
+            ov.useChromaKey = true;
+            parseChromaColor(argv[++i], ov.chromaKey);
         }
         else if ((arg == "-t" || arg == "--tolerance") && i + 1 < argc) {
-            cfg.chromaTolerance = stoi(argv[++i]);
+            ov.chromaTolerance = stoi(argv[++i]);
+        }
+        else if ((arg == "-sf" || arg == "--softness") && i + 1 < argc) {
+            ov.chromaSoftness = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--alpha") {
+            ov.alpha = true;
+        }
+        else if (arg == "--keyer" && i + 1 < argc) {
+            parseKeyer(argv[++i], ov.lutKeyer);
+        }
+        else if (arg == "--refine-matte") {
+            ov.refineMatte = true;
+        }
+        else if (arg == "--refine-radius" && i + 1 < argc) {
+            ov.refine.radius = max(1, stoi(argv[++i]));
+        }
+        else if (arg == "--despill" && i + 1 < argc) {
+            ov.despill = min(max(stof(argv[++i]), 0.f), 1.f);
         }
         else if ((arg == "-s" || arg == "--scale") && i + 1 < argc) {
-            cfg.overlayScale = stod(argv[++i]);
+            ov.overlayScale = stod(argv[++i]);
+        }
+        else if (arg == "--trim" && i + 1 < argc) {
+            if (!parseTrim(argv[++i], ov.trimIn, ov.trimOut)) {
+                cerr << "Erreur: Extrait invalide (in:out en secondes): " << argv[i] << endl;
+                return false;
+            }
+        }
+        else if (arg == "--blend" && i + 1 < argc) {
+            if (!parseBlendMode(argv[++i], ov.blendMode)) {
+                cerr << "Erreur: Mode de fusion invalide: " << argv[i] << endl;
+                return false;
+            }
+        }
+        else if (arg == "--opacity" && i + 1 < argc) {
+            ov.opacity = parseOpacity(stod(argv[++i]));
+        }
+        else if (arg == "--pip-radius" && i + 1 < argc) {
+            ov.pipStyle.radius = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--pip-border" && i + 1 < argc) {
+            ov.pipStyle.border = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--pip-border-color" && i + 1 < argc) {
+            if (!parseChromaColor(argv[++i], ov.pipStyle.borderColor)) {
+                cerr << "Erreur: Couleur de bordure invalide: " << argv[i] << endl;
+                return false;
+            }
+        }
+        else if (arg == "--pip-shadow" && i + 1 < argc) {
+            ov.pipStyle.shadow = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--pip-shadow-offset" && i + 1 < argc) {
+            if (!parseOffset(argv[++i], ov.pipStyle.shadowOffset)) {
+                cerr << "Erreur: Décalage d'ombre invalide (dx,dy): " << argv[i] << endl;
+                return false;
+            }
+        }
+        else if (arg == "--pip-shadow-opacity" && i + 1 < argc) {
+            ov.pipStyle.shadowOpacity = min(max(stod(argv[++i]), 0.0), 1.0);
+        }
+        else if (arg == "--motion" && i + 1 < argc) {
+            if (!motion::parsePath(argv[++i], ov.motion)) {
+                cerr << "Erreur: Trajectoire invalide: " << argv[i] << endl;
+                return false;
+            }
+        }
+        else if ((arg == "-z" || arg == "--z-order") && i + 1 < argc) {
+            ov.zOrder = stoi(argv[++i]);
+        }
+        else if (arg == "--resample" && i + 1 < argc) {
+            parseResampleMode(argv[++i], ov.resample);
+        }
+        else if (arg == "--playback" && i + 1 < argc) {
+            parsePlayback(argv[++i], ov.playback);
         }
+        else if (arg == "--cache-mb" && i + 1 < argc) {
+            cfg.cacheMB = static_cast<size_t>(max(0, stoi(argv[++i])));
+        }
+        else if (arg == "--no-frame-hash") {
+            cfg.frameHash = false;
+        }
+        else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            cfg.threads = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--queue" && i + 1 < argc) {
+            cfg.maxQueuedFrames = max(0, stoi(argv[++i]));
+        }
+        else if (arg == "--assert-no-buffer-alloc" || arg == "--assert-no-alloc") {
+            cfg.assertNoBufferAlloc = true;
+        }
+        else if (arg == "--bench-chroma") {
+            cfg.benchChroma = true;
+        }
+        else if (arg == "--bench-blend") {
+            cfg.benchBlend = true;
+        }
+        else if (arg == "--mosaic" && i + 1 < argc) {
+            cfg.mosaicGrid = argv[++i];
+        }
+        else if ((arg == "-i" || arg == "--input") && i + 1 < argc) {
+            cfg.mosaicInputs.push_back(argv[++i]);
+        }
+        else if (arg == "--mosaic-size" && i + 1 < argc) {
+            int w = 0, h = 0;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                cerr << "Erreur: Taille de mosaïque invalide: " << argv[i] << endl;
+                return false;
+            }
+            cfg.mosaicSize = Size(w, h);
+        }
+    }
+    
+    if (cfg.benchChroma || cfg.benchBlend) {
+        return true;
+    }
+    
+    if (!cfg.mosaicGrid.empty()) {
+        if (cfg.mosaicInputs.empty()) {
+            cerr << "Erreur: Le mode mosaïque nécessite au moins une vidéo (-i)\n";
+            return false;
+        }
+        if (cfg.outputVideo.empty()) {
+            cfg.outputVideo = "output.avi";
+        }
+        return true;
     }
     
-    if (cfg.mainVideo.empty() || cfg.overlayVideo.empty()) {
+    if (!ov.video.empty()) {
+        cfg.layers.push_back(ov);
+    }
+    if (!cfg.timelineFile.empty() && !loadTimeline(cfg.timelineFile, cfg.layers)) {
+        return false;
+    }
+    
+    if (cfg.mainVideo.empty() || cfg.layers.empty()) {
         cerr << "Erreur: Les vidéos principale et d'incrustation sont requises!\n";
         return false;
     }
@@ -147,43 +634,418 @@ Point calculatePosition(Position pos, int mainW, int mainH, int overlayW, int ov
     return Point(0, 0);
 }
 
-Mat applyChromaKey(const Mat& overlay, const Vec3b& chromaKey, int tolerance) {
-    Mat result = overlay.clone();
-    Mat alpha(overlay.rows, overlay.cols, CV_8UC1);
+// Frame de la vidéo principale où commence l'overlay
+// overlayDuration : durée de l'overlay exprimée en frames de la vidéo principale
+int calculateStartFrame(const LayerConfig& l, int mainFrameCount, double mainFps, int overlayDuration) {
+    int overlayStartFrame = 0;
     
-    for (int y = 0; y < overlay.rows; y++) {
-        for (int x = 0; x < overlay.cols; x++) {
-            Vec3b pixel = overlay.at<Vec3b>(y, x);
+    switch (l.timeAlign) {
+        case TimeAlign::START:
+            overlayStartFrame = 0;
+            cout << "  Alignement: Début de la vidéo\n";
+            break;
             
-            // Calculer la distance de couleur
-            int diff = abs(pixel[0] - chromaKey[0]) + 
-                      abs(pixel[1] - chromaKey[1]) + 
-                      abs(pixel[2] - chromaKey[2]);
+        case TimeAlign::END:
+            if (overlayDuration < mainFrameCount) {
+                overlayStartFrame = mainFrameCount - overlayDuration;
+            }
+            cout << "  Alignement: Fin de la vidéo (frame " << overlayStartFrame << ")\n";
+            break;
             
-            if (diff < tolerance * 3) {
-                alpha.at<uchar>(y, x) = 0; // Transparent
-            } else {
-                alpha.at<uchar>(y, x) = 255; // Opaque
+        case TimeAlign::FRAME:
+            overlayStartFrame = l.startFrame;
+            if (overlayStartFrame < 0) overlayStartFrame = 0;
+            if (overlayStartFrame > mainFrameCount) overlayStartFrame = mainFrameCount;
+            cout << "  Alignement: Frame spécifique " << overlayStartFrame << "\n";
+            break;
+            
+        case TimeAlign::TIMESTAMP:
+            overlayStartFrame = static_cast<int>(l.startTimestamp * mainFps);
+            if (overlayStartFrame < 0) overlayStartFrame = 0;
+            if (overlayStartFrame > mainFrameCount) overlayStartFrame = mainFrameCount;
+            cout << "  Alignement: Timestamp " << l.startTimestamp << "s (frame "
+                 << overlayStartFrame << ")\n";
+            break;
+    }
+    return overlayStartFrame;
+}
+
+void applyChromaKey(const Mat& overlay, Mat& alpha, const Vec3b& chromaKey, int tolerance,
+                    int softness) {
+    const uchar* before = alpha.data;
+    chroma::computeMatte(overlay, alpha, chromaKey, tolerance, softness);
+    framepool::trackBufferAllocation(before, alpha);
+}
+
+// Masque vide = overlay opaque ; binary = true : tout masque > 0 est opaque
+void overlayImage(Mat& background, const Mat& foreground, const Mat& mask, Point position,
+                  bool binary = true) {
+    composite::overlayROI(background, foreground, mask, position, binary);
+}
+
+// Frame d'overlay transmise aux workers
+struct OverlayFrame {
+    Mat image;              // frame brute, ou préparée si `prepared`
+    Mat mask;               // masque du chroma key (frames préparées uniquement)
+    bool prepared = false;
+    uint64_t hash = 0;      // empreinte complète si la frame ressemble à la précédente, sinon 0
+};
+
+// Overlay en cours de traitement : lecteur, géométrie et files du pipeline
+struct Layer {
+    LayerConfig cfg;
+    OverlayReader reader;
+    int frameCount = 0;       // frames natives de l'overlay
+    double fps = 0.0;
+    int duration = 0;         // durée en frames de la vidéo principale
+    int startFrame = 0;       // frame de la vidéo principale où l'overlay commence
+    Size nativeSize;
+    Size size;                // taille après mise à l'échelle
+    Point pos;
+    chroma::LutKeyer keyer;   // compilé une fois si --keyer lut
+    pip::Masks pipMasks;      // habillage PiP précalculé pour `size`
+    mutable matte::RefineStats refineStats;  // temps du raffinement, tous workers confondus
+    bool prepared = false;    // frames déjà détourées par le décodeur
+    unique_ptr<BoundedQueue<OverlayFrame>> queue;
+    unique_ptr<framepool::FramePool> pool;
+    unique_ptr<framepool::FramePool> maskPool;  // frames préparées avec chroma key
+    unique_ptr<FrameCache> cache;               // overlays en boucle / aller-retour
+    unique_ptr<framehash::PreparedCache> reuse; // dernière frame préparée (frames identiques)
+    bool done = false;        // plus de frame disponible (thread de décodage principal)
+};
+
+// Frame en transit dans le pipeline
+struct FrameJob {
+    int index = 0;
+    Mat frame;                      // frame principale, composée sur place
+    vector<OverlayFrame> overlays;  // une frame par overlay (vide si inactif sur cette frame)
+};
+
+// Emplacements d'overlays des FrameJob, dimensionnés une fois puis recyclés :
+// le worker les rend vidés, le décodeur les reprend pour la frame suivante
+class OverlaySlots {
+public:
+    OverlaySlots(size_t layers, size_t capacity) : layers_(layers) { free_.reserve(capacity); }
+
+    vector<OverlayFrame> acquire() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (!free_.empty()) {
+                vector<OverlayFrame> slots = std::move(free_.back());
+                free_.pop_back();
+                return slots;
             }
         }
+        return vector<OverlayFrame>(layers_);  // warm-up
+    }
+
+    void release(vector<OverlayFrame>&& slots) {
+        for (OverlayFrame& of : slots) of = OverlayFrame();
+        lock_guard<mutex> lock(mutex_);
+        free_.push_back(std::move(slots));
+    }
+
+private:
+    size_t layers_;
+    vector<vector<OverlayFrame>> free_;
+    mutex mutex_;
+};
+
+// Chroma key de l'overlay (keyer LUT si compilé, distance BGR sinon)
+void keyOverlay(const Layer& layer, Mat& overlay, Mat& alpha) {
+    const LayerConfig& l = layer.cfg;
+    if (layer.keyer.empty()) {
+        applyChromaKey(overlay, alpha, l.chromaKey, l.chromaTolerance, l.chromaSoftness);
+        return;
+    }
+    const uchar* before = alpha.data;
+    layer.keyer.apply(overlay, alpha);
+    framepool::trackBufferAllocation(before, alpha);
+}
+
+// Raffinement optionnel du masque, chronométré à part
+void refineOverlayMatte(const Layer& layer, const Mat& overlay, Mat& alpha, matte::RefineScratch& scratch) {
+    if (layer.cfg.refineMatte) {
+        matte::refineTimed(overlay, alpha, layer.cfg.refine, scratch, layer.refineStats);
+    }
+}
+
+// Buffers de travail d'un worker pour un overlay, réutilisés d'une frame à l'autre
+struct CompositeScratch {
+    Mat mask;
+    Mat warped;      // trajectoires : overlay transformé (boîte englobante)
+    Mat warpedMask;
+    Mat opaque;      // couverture d'un overlay sans masque
+    Mat styled;      // habillage PiP (warp, fusion) : overlay BGRA ou masque multipliés par les coins
+    Mat styledMask;
+    Mat decoWarped;  // habillage PiP : ombre et bordure transformées (trajectoires)
+    matte::RefineScratch refine;
+};
+
+// Place l'overlay préparé sur la frame, à l'instant t (secondes depuis son début)
+void placeOverlay(const Layer& layer, Mat& frame, const Mat& srcImage, const Mat& srcMask, bool srcBinary,
+                  double t, CompositeScratch& scratch) {
+    const LayerConfig& l = layer.cfg;
+    // Overlay BGRA prémultiplié (--alpha) ou BGR + masque ; fusion et opacité sur la zone visible
+    auto draw = [&](const Mat& img, const Mat& msk, Point at, bool bin) {
+        if (l.blendMode != blend::Mode::NORMAL || l.opacity < 255) {
+            blend::overlay(frame, img, msk, at, bin, l.blendMode, l.opacity);
+        } else if (img.type() == CV_8UC4) {
+            composite::overlayPremultiplied(frame, img, at);
+        } else {
+            overlayImage(frame, img, msk, at, bin);
+        }
+    };
+    
+    // Habillage PiP : ombre et bordure précalculées dessous, coins arrondis sur l'overlay
+    const pip::Masks& style = layer.pipMasks;
+    // La décoration suit le placement de l'overlay, décalée de son débord ; toujours
+    // en fusion normale (une ombre en mode multiply ou screen n'aurait pas de sens)
+    auto decorate = [&](const motion::Placement& p) {
+        const Mat& deco = style.decoration();
+        if (deco.empty()) return;
+        Point off = style.decorationOffset();
+        motion::Placement dp;
+        dp.x = p.x + p.scale * off.x;
+        dp.y = p.y + p.scale * off.y;
+        dp.scale = p.scale;
+        Point at;
+        Mat warped;
+        if (!dp.integerTranslation(at)) {
+            const uchar* before = scratch.decoWarped.data;
+            if (!motion::warpToBox(deco, dp, frame.size(), scratch.decoWarped, warped, at)) return;
+            framepool::trackBufferAllocation(before, scratch.decoWarped);
+        }
+        if (l.opacity < 255) {
+            blend::overlay(frame, warped.empty() ? deco : warped, Mat(), at, false, blend::Mode::NORMAL, l.opacity);
+        } else if (warped.empty()) {
+            pip::drawDecoration(frame, style, at);  // segments non transparents seulement
+        } else {
+            composite::overlayPremultiplied(frame, warped, at);
+        }
+    };
+    
+    // Translation entière : copie directe, sans warp
+    motion::Placement p;
+    p.x = layer.pos.x;
+    p.y = layer.pos.y;
+    if (!l.motion.empty()) p = l.motion.at(t);
+    decorate(p);
+    Point ip;
+    const bool integer = p.integerTranslation(ip);
+    
+    // Cas courant : coins appliqués par le noyau d'incrustation, en un seul passage
+    const bool normalBlend = l.blendMode == blend::Mode::NORMAL && l.opacity == 255;
+    if (integer && normalBlend && !style.coverage().empty()) {
+        pip::drawCovered(frame, srcImage, srcMask, srcBinary, style, ip);
+        return;
+    }
+    
+    // Sinon (warp, fusion, opacité) : coins multipliés dans une copie de l'overlay
+    const Mat* imagePtr = &srcImage;
+    const Mat* maskPtr = &srcMask;
+    bool binary = srcBinary;
+    if (!style.coverage().empty()) {
+        if (srcImage.type() == CV_8UC4) {
+            pip::coverBGRA(srcImage, style.coverage(), scratch.styled);
+            imagePtr = &scratch.styled;
+        } else if (srcMask.empty()) {
+            maskPtr = &style.coverage();
+        } else {
+            pip::combineMask(srcMask, srcBinary, style.coverage(), scratch.styledMask);
+            maskPtr = &scratch.styledMask;
+        }
+        binary = false;
+    }
+    const Mat& image = *imagePtr;
+    const Mat& mask = *maskPtr;
+    if (integer) {
+        draw(image, mask, ip, binary);
+        return;
+    }
+    
+    if (image.type() == CV_8UC4) {
+        // Le warp d'une image prémultipliée donne directement une couverture correcte
+        const uchar* before = scratch.warped.data;
+        Mat warped;
+        Point origin;
+        if (!motion::warpToBox(image, p, frame.size(), scratch.warped, warped, origin)) return;
+        framepool::trackBufferAllocation(before, scratch.warped);
+        draw(warped, Mat(), origin, false);
+        return;
     }
     
-    return alpha;
+    if (mask.empty() && scratch.opaque.size() != image.size()) {
+        const uchar* before = scratch.opaque.data;
+        scratch.opaque.create(image.size(), CV_8UC1);
+        scratch.opaque.setTo(Scalar(255));
+        framepool::trackBufferAllocation(before, scratch.opaque);
+    }
+    
+    const uchar* before = scratch.warped.data;
+    Mat warped, warpedMask;
+    Point origin;
+    if (!motion::warpToBox(image, mask, scratch.opaque, p, frame.size(), scratch.warped,
+                           scratch.warpedMask, warped, warpedMask, origin)) {
+        return;
+    }
+    framepool::trackBufferAllocation(before, scratch.warped);
+    // Bords sub-pixel : toujours mélangés
+    draw(warped, warpedMask, origin, false);
 }
 
-void overlayImage(Mat& background, const Mat& foreground, const Mat& mask, Point position) {
-    for (int y = 0; y < foreground.rows; y++) {
-        for (int x = 0; x < foreground.cols; x++) {
-            int bgX = position.x + x;
-            int bgY = position.y + y;
-            
-            if (bgX >= 0 && bgX < background.cols && bgY >= 0 && bgY < background.rows) {
-                if (mask.at<uchar>(y, x) > 0) {
-                    background.at<Vec3b>(bgY, bgX) = foreground.at<Vec3b>(y, x);
-                }
+// Compose l'overlay sur place dans `frame`
+void compositeFrame(const Layer& layer, Mat& frame, Mat& overlayFrame, uint64_t hash, double t,
+                    CompositeScratch& scratch) {
+    const LayerConfig& l = layer.cfg;
+    
+    // Frame identique à la dernière frame préparée : ni redimensionnement ni chroma key
+    if (layer.reuse) {
+        // Instantané partagé : lu sans copie, gardé vivant pendant la composition
+        framehash::PreparedPtr reused = layer.reuse->lookup(hash, overlayFrame);
+        if (reused) {
+            placeOverlay(layer, frame, reused->image, l.useChromaKey ? reused->mask : Mat(),
+                         !l.useChromaKey || l.binaryMatte(), t, scratch);
+            return;
+        }
+    }
+    
+    // L'overlay arrive déjà à sa taille finale (réduit dans le thread de décodage)
+    Mat* overlay = &overlayFrame;
+    
+    // Source brute copiée avant le détourage (le despill la modifie sur place) :
+    // elle confirme octet par octet les correspondances d'empreinte suivantes
+    Mat source;
+    if (layer.reuse && hash && !layer.reuse->holds(hash)) source = overlayFrame.clone();
+    
+    if (l.useChromaKey) {
+        // Appliquer le chroma key
+        keyOverlay(layer, *overlay, scratch.mask);
+        refineOverlayMatte(layer, *overlay, scratch.mask, scratch.refine);
+        if (!source.empty()) layer.reuse->store(hash, source, *overlay, scratch.mask);
+        placeOverlay(layer, frame, *overlay, scratch.mask, l.binaryMatte(), t, scratch);
+    } else {
+        // Incrustation simple (sans transparence)
+        if (!source.empty()) layer.reuse->store(hash, source, *overlay, Mat());
+        placeOverlay(layer, frame, *overlay, Mat(), true, t, scratch);
+    }
+}
+
+// Détoure sur place une frame déjà à sa taille finale (overlays en boucle, côté décodeur)
+void prepareOverlay(const Layer& layer, Mat& image, Mat& mask, matte::RefineScratch& refineScratch) {
+    const LayerConfig& l = layer.cfg;
+    if (l.useChromaKey) {
+        keyOverlay(layer, image, mask);
+        refineOverlayMatte(layer, image, mask, refineScratch);
+        clearTransparent(image, mask);
+    }
+}
+
+// Frame native à afficher pour l'index `k` de l'overlay (boucle / aller-retour)
+int playbackIndex(const Layer& layer, int k) {
+    int count = layer.frameCount;
+    if (count <= 0) return k;
+    switch (layer.cfg.playback) {
+        case Playback::ONCE:
+            return k;
+        case Playback::LOOP:
+            return k % count;
+        case Playback::PINGPONG: {
+            if (count == 1) return 0;
+            int period = 2 * count - 2;
+            int p = k % period;
+            return p < count ? p : period - p;
+        }
+    }
+    return k;
+}
+
+// Thread de décodage d'un overlay : produit une frame par frame principale active
+void decodeOverlay(Layer& layer, double mainFps) {
+    if (!layer.prepared) {
+        uint64_t prevSample = 0;
+        for (int n = 0; n < layer.duration; n++) {
+            OverlayFrame of;
+            of.image = layer.pool->acquire();
+            const uchar* before = of.image.data;
+            // Correspondance par temps de présentation ; lecture séquentielle,
+            // seek uniquement si la timeline saute
+            if (!layer.reader.readAt(n / mainFps, layer.fps, of.image, layer.cfg.resample)) {
+                layer.pool->release(std::move(of.image));
+                break;
+            }
+            framepool::trackBufferAllocation(before, of.image);
+            // Empreinte complète seulement si l'échantillon ne change pas d'une frame à l'autre
+            if (layer.reuse) {
+                uint64_t sample = framehash::sampled(of.image);
+                if (sample == prevSample) of.hash = framehash::full(of.image);
+                prevSample = sample;
             }
+            if (!layer.queue->push(std::move(of))) break;
         }
+        layer.queue->close();
+        return;
     }
+    
+    // Boucle / aller-retour : les frames préparées sont mises en cache compressé,
+    // les cycles suivants ne font plus que décompresser
+    Mat lastImage, lastMask;
+    matte::RefineScratch refineScratch;
+    int lastIndex = -1;
+    bool warned = false;
+    // Frame k préparée dans `of` : cache, frame répétée, ou décodage (mis en cache)
+    auto fetch = [&](int k, OverlayFrame& of) {
+        if (layer.cache->get(k, of.image, of.mask)) return true;  // décompression seule
+        if (k == lastIndex) {
+            // Frame répétée (overlay plus lent) absente du cache
+            lastImage.copyTo(of.image);
+            if (!lastMask.empty()) lastMask.copyTo(of.mask);
+            return true;
+        }
+        const uchar* before = of.image.data;
+        if (!layer.reader.read(k, of.image)) return false;
+        framepool::trackBufferAllocation(before, of.image);
+        prepareOverlay(layer, of.image, of.mask, refineScratch);
+        if (!layer.cache->put(k, of.image, of.mask)) {
+            if (!warned) {
+                cerr << "Avertissement: cache plein pour " << layer.cfg.video
+                     << ", les cycles suivants seront redécodés (--cache-mb)\n";
+                warned = true;
+            }
+            of.image.copyTo(lastImage);
+            if (!of.mask.empty()) of.mask.copyTo(lastMask);
+        }
+        return true;
+    };
+    for (int n = 0; n < layer.duration; n++) {
+        const int natural = OverlayReader::frameAt(n / mainFps, layer.fps);
+        int k = playbackIndex(layer, natural);
+        
+        OverlayFrame of;
+        of.prepared = true;
+        of.image = layer.pool->acquire();
+        if (layer.maskPool) of.mask = layer.maskPool->acquire();
+        
+        bool ok = fetch(k, of);
+        if (!ok && k > 0 && k < layer.frameCount) {
+            // Nombre de frames surestimé par le conteneur : la boucle se referme
+            // sur les frames réellement décodées au lieu de faire disparaître l'overlay
+            cerr << "Avertissement: " << layer.cfg.video << " n'a que " << k
+                 << " frames lisibles, boucle raccourcie\n";
+            layer.frameCount = k;
+            k = playbackIndex(layer, natural);
+            ok = fetch(k, of);
+        }
+        lastIndex = k;
+        
+        if (!ok) {
+            layer.pool->release(std::move(of.image));
+            if (layer.maskPool) layer.maskPool->release(std::move(of.mask));
+            break;
+        }
+        if (!layer.queue->push(std::move(of))) break;
+    }
+    layer.queue->close();
 }
 
 int main(int argc, char** argv) {
@@ -193,131 +1055,343 @@ int main(int argc, char** argv) {
         return 1;
     }
     
-    // Ouvrir les vidéos
+    if (cfg.benchChroma || cfg.benchBlend) {
+        if (cfg.benchChroma) chroma::benchmarkMatte();
+        if (cfg.benchBlend) blend::benchmark();
+        return 0;
+    }
+    
+    if (!cfg.mosaicGrid.empty()) {
+        mosaic::Options opt;
+        opt.inputs = cfg.mosaicInputs;
+        opt.output = cfg.outputVideo;
+        opt.size = cfg.mosaicSize;
+        if (cfg.maxQueuedFrames > 0) opt.maxQueuedFrames = cfg.maxQueuedFrames;
+        if (!mosaic::parseGrid(cfg.mosaicGrid, static_cast<int>(opt.inputs.size()), opt.grid)) {
+            cerr << "Erreur: Grille invalide: " << cfg.mosaicGrid << endl;
+            return 1;
+        }
+        return mosaic::run(opt);
+    }
+    
+    // Ouvrir la vidéo principale
     VideoCapture mainCap(cfg.mainVideo);
-    VideoCapture overlayCap(cfg.overlayVideo);
     
     if (!mainCap.isOpened()) {
         cerr << "Erreur: Impossible d'ouvrir la vidéo principale: " << cfg.mainVideo << endl;
         return 1;
     }
     
-    if (!overlayCap.isOpened()) {
-        cerr << "Erreur: Impossible d'ouvrir la vidéo d'incrustation: " << cfg.overlayVideo << endl;
-        return 1;
-    }
-    
     // Récupérer les propriétés
     int mainW = static_cast<int>(mainCap.get(CAP_PROP_FRAME_WIDTH));
     int mainH = static_cast<int>(mainCap.get(CAP_PROP_FRAME_HEIGHT));
-    double mainFps = mainCap.get(CAP_PROP_FPS);
-    int mainFrameCount = static_cast<int>(mainCap.get(CAP_PROP_FRAME_COUNT));
+    // Nombre de frames exact (index du conteneur ou démultiplexage, cf. media_probe.h)
+    probe::MediaInfo mainInfo = probe::probe(cfg.mainVideo);
+    double mainFps = mainInfo.fps > 0.0 ? mainInfo.fps : mainCap.get(CAP_PROP_FPS);
+    int mainFrameCount = mainInfo.exact ? mainInfo.frames()
+                                        : static_cast<int>(mainCap.get(CAP_PROP_FRAME_COUNT));
+    if (mainFps <= 0.0) {
+        mainFps = 25.0;
+        cerr << "Avertissement: FPS non disponible, utilisation de 25 fps.\n";
+    }
     
-    int overlayW = static_cast<int>(overlayCap.get(CAP_PROP_FRAME_WIDTH) * cfg.overlayScale);
-    int overlayH = static_cast<int>(overlayCap.get(CAP_PROP_FRAME_HEIGHT) * cfg.overlayScale);
-    int overlayFrameCount = static_cast<int>(overlayCap.get(CAP_PROP_FRAME_COUNT));
+    cout << "Vidéo principale: " << mainW << "x" << mainH << " @ " << mainFps << " fps, "
+         << mainFrameCount << " frames" << (mainInfo.exact ? "" : " (estimation)") << "\n";
+         
+    // Ouvrir les overlays et les placer sur la timeline
+    vector<unique_ptr<Layer>> layers;
+    IntervalIndex schedule;
     
-    cout << "Vidéo principale: " << mainW << "x" << mainH << " @ " << mainFps << " fps, " 
-         << mainFrameCount << " frames\n";
-    cout << "Vidéo overlay: " << overlayW << "x" << overlayH << ", " 
-         << overlayFrameCount << " frames\n";
+    for (size_t i = 0; i < cfg.layers.size(); i++) {
+        unique_ptr<Layer> layer(new Layer());
+        layer->cfg = cfg.layers[i];
+        const LayerConfig& l = layer->cfg;
+        
+        if (!layer->reader.open(l.video, l.alpha)) {
+            cerr << "Erreur: Impossible d'ouvrir la vidéo d'incrustation: " << l.video << endl;
+            return 1;
+        }
+        
+        layer->nativeSize = Size(static_cast<int>(layer->reader.get(CAP_PROP_FRAME_WIDTH)),
+                                 static_cast<int>(layer->reader.get(CAP_PROP_FRAME_HEIGHT)));
+        layer->size = Size(static_cast<int>(layer->nativeSize.width * l.overlayScale),
+                           static_cast<int>(layer->nativeSize.height * l.overlayScale));
+        if (layer->size != layer->nativeSize) {
+            layer->reader.setOutputSize(layer->size);
+        }
+        layer->frameCount = static_cast<int>(layer->reader.get(CAP_PROP_FRAME_COUNT));
+        layer->fps = layer->reader.get(CAP_PROP_FPS);
+        probe::MediaInfo info;
+        if (!AlphaCapture::isImagePath(l.video)) {
+            info = probe::probe(l.video);
+            if (info.exact) layer->frameCount = info.frames();
+            if (info.fps > 0.0) layer->fps = info.fps;
+        }
+        if (layer->fps <= 0.0) layer->fps = mainFps;
+        
+        // Extrait : la durée de l'overlay devient celle de [in, out)
+        bool trimmed = l.trimIn > 0.0 || l.trimOut >= 0.0;
+        int trimIn = 0, trimOut = layer->frameCount, trimKeyframe = -1;
+        if (trimmed) {
+            trimIn = min(cvRound(l.trimIn * layer->fps), layer->frameCount);
+            if (l.trimOut >= 0.0) trimOut = min(cvRound(l.trimOut * layer->fps), layer->frameCount);
+            trimOut = max(trimOut, trimIn);
+            if (!info.keyframes.empty()) trimKeyframe = static_cast<int>(info.keyframeBefore(trimIn));
+            layer->reader.setRange(trimIn, trimOut, trimKeyframe);
+            layer->frameCount = trimOut - trimIn;
+        }
+        
+        // Durée par temps de présentation : un overlay 24 fps sur 60 fps dure 2.5x plus de frames
+        layer->duration = static_cast<int>(ceil(layer->frameCount * mainFps / layer->fps - 1e-6));
+        // Un overlay plus rapide saute des frames : grab() plutôt qu'un seek
+        layer->reader.setMaxSkip(max(8, static_cast<int>(ceil(2.0 * layer->fps / mainFps))));
+        
+        cout << "Vidéo overlay " << (i + 1) << "/" << cfg.layers.size() << " (" << l.video << "): "
+             << layer->size.width << "x" << layer->size.height << " @ " << layer->fps << " fps, "
+             << layer->frameCount << " frames (" << layer->duration << " frames principales), z="
+             << l.zOrder << "\n";
+        if (trimmed) {
+            cout << "  Extrait: frames " << trimIn << " à " << trimOut;
+            if (trimKeyframe >= 0) cout << " (un seek sur la keyframe " << trimKeyframe << ")";
+            cout << "\n";
+        }
+             
+        if (l.alpha && l.useChromaKey) {
+            cout << "  Canal alpha natif : chroma key ignoré\n";
+            layer->cfg.useChromaKey = false;
+        }
+        if (l.useChromaKey && l.lutKeyer) {
+            chroma::LutKeyParams kp;
+            kp.key = l.chromaKey;
+            kp.tolerance = l.chromaTolerance;
+            kp.softness = l.chromaSoftness;
+            kp.despill = l.despill;
+            layer->keyer.build(kp);
+            cout << "  Keyer LUT YCbCr " << chroma::LutKeyer::kSize << "^3, despill " << l.despill << "\n";
+        }
+        
+        if (l.blendMode != blend::Mode::NORMAL || l.opacity < 255) {
+            cout << "  Fusion: " << blend::modeName(l.blendMode) << ", opacité " << (l.opacity / 255.0) << "\n";
+        }
+        if (l.pipStyle.enabled()) {
+            // Masques calculés une fois pour la taille finale de l'overlay ; la décoration
+            // n'est cachée que par un overlay réellement opaque (ni alpha, ni opacité, ni fusion)
+            const bool opaqueContent = !l.useChromaKey && !l.alpha && l.opacity == 255
+                                       && l.blendMode == blend::Mode::NORMAL;
+            layer->pipMasks.build(layer->size, l.pipStyle, opaqueContent);
+            cout << "  Habillage PiP: coins " << l.pipStyle.radius << " px, bordure " << l.pipStyle.border
+                 << " px, ombre " << l.pipStyle.shadow << " px\n";
+        }
+        
+        // Calculer la position
+        layer->pos = calculatePosition(l.position, mainW, mainH, layer->size.width,
+                                       layer->size.height, l.customX, l.customY);
+        if (l.motion.empty()) {
+            cout << "  Position d'incrustation: (" << layer->pos.x << ", " << layer->pos.y << ")\n";
+        } else {
+            cout << "  Trajectoire animée (échelle max " << l.motion.maxScale() << ")\n";
+        }
+        
+        // Calculer le décalage temporel
+        layer->startFrame = calculateStartFrame(l, mainFrameCount, mainFps, layer->duration);
+        
+        // En boucle, l'overlay reste actif jusqu'à la fin de la vidéo principale
+        if (l.playback != Playback::ONCE) {
+            layer->prepared = true;
+            layer->duration = INT_MAX / 2;
+            cout << "  Lecture: " << (l.playback == Playback::LOOP ? "en boucle" : "aller-retour") << "\n";
+        }
+        
+        schedule.add(static_cast<int>(i), layer->startFrame,
+                     layer->startFrame + layer->duration, l.zOrder);
+        layers.push_back(std::move(layer));
+    }
     
-    // Calculer la position
-    Point overlayPos = calculatePosition(cfg.position, mainW, mainH, overlayW, overlayH, 
-                                        cfg.customX, cfg.customY);
-    cout << "Position d'incrustation: (" << overlayPos.x << ", " << overlayPos.y << ")\n";
+    // Ordre de composition : z croissant, puis ordre de déclaration
+    vector<int> drawOrder(layers.size());
+    for (size_t i = 0; i < drawOrder.size(); i++) drawOrder[i] = static_cast<int>(i);
+    stable_sort(drawOrder.begin(), drawOrder.end(), [&](int a, int b) {
+        return layers[a]->cfg.zOrder < layers[b]->cfg.zOrder;
+    });
     
-    // Calculer le décalage temporel
-    int overlayStartFrame = 0;
+    int threads = cfg.threads > 0 ? cfg.threads
+                                  : max(1, static_cast<int>(thread::hardware_concurrency()));
+    int queueSize = cfg.maxQueuedFrames > 0 ? cfg.maxQueuedFrames : 2 * threads;
     
-    switch (cfg.timeAlign) {
-        case TimeAlign::START:
-            overlayStartFrame = 0;
-            cout << "Alignement: Début de la vidéo\n";
-            break;
-            
-        case TimeAlign::END:
-            if (overlayFrameCount < mainFrameCount) {
-                overlayStartFrame = mainFrameCount - overlayFrameCount;
-            }
-            cout << "Alignement: Fin de la vidéo (frame " << overlayStartFrame << ")\n";
-            break;
-            
-        case TimeAlign::FRAME:
-            overlayStartFrame = cfg.startFrame;
-            if (overlayStartFrame < 0) overlayStartFrame = 0;
-            if (overlayStartFrame > mainFrameCount) overlayStartFrame = mainFrameCount;
-            cout << "Alignement: Frame spécifique " << overlayStartFrame << "\n";
-            break;
-            
-        case TimeAlign::TIMESTAMP:
-            overlayStartFrame = static_cast<int>(cfg.startTimestamp * mainFps);
-            if (overlayStartFrame < 0) overlayStartFrame = 0;
-            if (overlayStartFrame > mainFrameCount) overlayStartFrame = mainFrameCount;
-            cout << "Alignement: Timestamp " << cfg.startTimestamp << "s (frame " 
-                 << overlayStartFrame << ")\n";
-            break;
-    }
+    // Créer les writers : la sortie principale, puis les sorties supplémentaires
+    vector<rendition::Spec> outputs;
+    rendition::Spec primary;
+    primary.path = cfg.outputVideo;
+    outputs.push_back(primary);
+    outputs.insert(outputs.end(), cfg.renditions.begin(), cfg.renditions.end());
     
-    // Créer le writer
-    VideoWriter writer(cfg.outputVideo, 
-                      VideoWriter::fourcc('M','J','P','G'),
-                      mainFps,
-                      Size(mainW, mainH));
-    
-    if (!writer.isOpened()) {
-        cerr << "Erreur: Impossible de créer la vidéo de sortie\n";
+    rendition::Fanout writers;
+    if (!writers.open(outputs, mainFps, Size(mainW, mainH), queueSize)) {
         return 1;
     }
     
-    cout << "Traitement en cours...\n";
+    cout << "Traitement en cours (" << threads << " threads, file de " << queueSize << " frames)...\n";
     
-    Mat mainFrame, overlayFrame, overlayResized;
-    int frameNum = 0;
+    // Pipeline : décodage principal | décodage des overlays -> workers -> écriture ordonnée
+    BoundedQueue<FrameJob> workQueue(queueSize);
+    ReorderBuffer<Mat> reorder(queueSize + threads);
     
-    while (mainCap.read(mainFrame)) {
-        Mat outputFrame = mainFrame.clone();
-        
-        // Vérifier si on doit afficher l'overlay sur cette frame
-        int overlayFrameNum = frameNum - overlayStartFrame;
-        
-        if (overlayFrameNum >= 0 && overlayFrameNum < overlayFrameCount) {
-            // Positionner l'overlay au bon frame
-            overlayCap.set(CAP_PROP_POS_FRAMES, overlayFrameNum);
+    // Buffers recyclés : de quoi remplir toutes les files, plus un par thread
+    // (+ une file par sortie, chaque frame restant en circulation jusqu'à la plus lente)
+    size_t mainPoolSize = 2 * queueSize + 2 * threads + 2 + writers.size() * queueSize;
+    framepool::FramePool mainPool(Size(mainW, mainH), CV_8UC3, mainPoolSize);
+    size_t overlayPoolSize = 2 * queueSize + threads + 2;
+    OverlaySlots overlaySlots(layers.size(), queueSize + threads + 2);
+    for (auto& layer : layers) {
+        layer->queue.reset(new BoundedQueue<OverlayFrame>(queueSize));
+        // Les frames sortent du décodeur à leur taille finale
+        int poolType = layer->cfg.alpha ? CV_8UC4 : CV_8UC3;
+        layer->pool.reset(new framepool::FramePool(layer->size, poolType, overlayPoolSize));
+        // Inutile sans chroma key : rien à réutiliser
+        if (cfg.frameHash && !layer->prepared && layer->cfg.useChromaKey) {
+            layer->reuse.reset(new framehash::PreparedCache());
+        }
+        if (layer->prepared) {
+            layer->cache.reset(new FrameCache(cfg.cacheMB * 1024 * 1024));
+            if (layer->cfg.useChromaKey) {
+                layer->maskPool.reset(new framepool::FramePool(layer->size, CV_8UC1, overlayPoolSize));
+            }
+        }
+    }
+    
+    // Un thread de décodage par overlay
+    vector<thread> overlayThreads;
+    for (auto& layerPtr : layers) {
+        Layer* layer = layerPtr.get();
+        overlayThreads.emplace_back([layer, mainFps] { decodeOverlay(*layer, mainFps); });
+    }
+    
+    thread decodeThread([&] {
+        for (int index = 0; ; index++) {
+            FrameJob job;
+            job.index = index;
+            job.frame = mainPool.acquire();
+            const uchar* before = job.frame.data;
+            if (!mainCap.read(job.frame)) {
+                mainPool.release(std::move(job.frame));
+                break;
+            }
+            framepool::trackBufferAllocation(before, job.frame);
             
-            if (overlayCap.read(overlayFrame)) {
-                // Redimensionner l'overlay si nécessaire
-                if (cfg.overlayScale != 1.0) {
-                    resize(overlayFrame, overlayResized, Size(overlayW, overlayH));
-                } else {
-                    overlayResized = overlayFrame;
+            // Récupérer une frame de chaque overlay actif sur cette frame
+            job.overlays = overlaySlots.acquire();
+            for (int id : schedule.activeAt(index)) {
+                Layer& layer = *layers[id];
+                if (!layer.done) {
+                    layer.done = !layer.queue->pop(job.overlays[id]);
                 }
-                
-                if (cfg.useChromaKey) {
-                    // Appliquer le chroma key
-                    Mat mask = applyChromaKey(overlayResized, cfg.chromaKey, cfg.chromaTolerance);
-                    overlayImage(outputFrame, overlayResized, mask, overlayPos);
-                } else {
-                    // Incrustation simple (sans transparence)
-                    Mat mask = Mat::ones(overlayResized.rows, overlayResized.cols, CV_8UC1) * 255;
-                    overlayImage(outputFrame, overlayResized, mask, overlayPos);
+            }
+            
+            if (!workQueue.push(std::move(job))) break;
+        }
+        for (auto& layer : layers) layer->queue->close();
+        workQueue.close();
+    });
+    
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            vector<CompositeScratch> scratch(layers.size());
+            FrameJob job;
+            while (workQueue.pop(job)) {
+                for (int id : drawOrder) {
+                    OverlayFrame& of = job.overlays[id];
+                    if (of.image.empty()) continue;
+                    Layer& layer = *layers[id];
+                    double t = (job.index - layer.startFrame) / mainFps;
+                    if (of.prepared) {
+                        placeOverlay(layer, job.frame, of.image, of.mask,
+                                     layer.cfg.binaryMatte(), t, scratch[id]);
+                    } else {
+                        compositeFrame(layer, job.frame, of.image, of.hash, t, scratch[id]);
+                    }
+                    layer.pool->release(std::move(of.image));
+                    if (layer.maskPool) layer.maskPool->release(std::move(of.mask));
                 }
+                overlaySlots.release(std::move(job.overlays));
+                reorder.put(job.index, std::move(job.frame));
+            }
+        });
+    }
+    
+    // Le compteur est relevé une fois toutes les réserves remplies (warm-up)
+    int warmupFrames = static_cast<int>(mainPoolSize);
+    long long warmupBufferAllocations = -1;
+    int frameNum = 0;
+    thread writerThread([&] {
+        Mat outputFrame;
+        while (reorder.take(outputFrame)) {
+            // Partagée en lecture seule par les sorties, rendue à la réserve par la dernière
+            writers.push(rendition::SharedFrame(new Mat(std::move(outputFrame)), [&mainPool](const Mat* m) {
+                mainPool.release(*m);
+                delete m;
+            }));
+            
+            frameNum++;
+            if (frameNum == warmupFrames) {
+                warmupBufferAllocations = framepool::bufferAllocations();
+            }
+            if (frameNum % 30 == 0) {
+                cout << "Frame " << frameNum << "/" << mainFrameCount << "\r" << flush;
             }
         }
-        
-        writer.write(outputFrame);
-        
-        frameNum++;
-        if (frameNum % 30 == 0) {
-            cout << "Frame " << frameNum << "/" << mainFrameCount << "\r" << flush;
+    });
+    
+    decodeThread.join();
+    for (auto& t : overlayThreads) t.join();
+    for (auto& w : workers) w.join();
+    reorder.finish();
+    writerThread.join();
+    writers.finish();
+    
+    cout << "\nTraitement terminé! Vidéo sauvegardée: " << cfg.outputVideo << endl;
+    if (writers.size() > 1) {
+        writers.report(cout);
+    }
+    for (size_t i = 0; i < layers.size(); i++) {
+        cout << "Seeks overlay " << (i + 1) << ": " << layers[i]->reader.seekCount() << endl;
+        if (layers[i]->reuse && layers[i]->reuse->lookups() > 0) {
+            const framehash::PreparedCache& reuse = *layers[i]->reuse;
+            cout << "  Frames identiques réutilisées: " << reuse.hits() << "/" << reuse.lookups()
+                 << " (" << (100.0 * reuse.hits() / reuse.lookups()) << " %)" << endl;
+            if (reuse.collisions() > 0) {
+                cout << "  Collisions d'empreinte écartées: " << reuse.collisions() << endl;
+            }
+        }
+        if (layers[i]->refineStats.frames > 0) {
+            const matte::RefineStats& rs = layers[i]->refineStats;
+            cout << "  Raffinement du masque: " << rs.frames.load() << " frames, " << rs.totalMs() << " ms ("
+                 << rs.msPerFrame() << " ms/frame)" << endl;
+        }
+        if (layers[i]->cache) {
+            const FrameCache& cache = *layers[i]->cache;
+            cout << "  Cache: " << cache.size() << " frames, " << (cache.bytes() >> 20) << " Mo compressés"
+                 << " (ratio " << (cache.rawBytes() ? double(cache.bytes()) / cache.rawBytes() : 0.0)
+                 << "), " << cache.hits() << " frames servies sans décodage" << endl;
         }
     }
     
-    cout << "\nTraitement terminé! Vidéo sauvegardée: " << cfg.outputVideo << endl;
+    long long totalBufferAllocations = framepool::bufferAllocations();
+    cout << "Allocations de buffers image: " << totalBufferAllocations;
+    if (warmupBufferAllocations >= 0) {
+        long long steady = totalBufferAllocations - warmupBufferAllocations;
+        cout << " (après warm-up: " << steady << " sur " << (frameNum - warmupFrames)
+             << " frames)" << endl;
+        if (cfg.assertNoBufferAlloc && steady > 0) {
+            cerr << "Erreur: buffers image alloués après le warm-up\n";
+            return 2;
+        }
+    } else {
+        cout << " (vidéo trop courte pour mesurer le régime établi)" << endl;
+    }
     
     mainCap.release();
-    overlayCap.release();
-    writer.release();
+    for (auto& layer : layers) layer->reader.release();
     
     return 0;
 }
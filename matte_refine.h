@@ -0,0 +1,119 @@
+#ifndef MATTE_REFINE_H
+#define MATTE_REFINE_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// Raffinement du masque de chroma key par filtre guidé rapide (He & Sun, 2015).
+//
+// Un masque binaire donne des bords en escalier (cheveux, contours). Le
+// masque et l'overlay (en niveaux de gris, comme guide) sont réduits d'un
+// facteur `factor` (INTER_AREA : le masque binaire devient un alpha doux),
+// les coefficients linéaires a, b du filtre guidé sont calculés à cette basse
+// résolution, puis agrandis et appliqués au guide pleine résolution :
+//   alpha = a * I + b
+// Le coût des filtres boîte est donc divisé par factor², seule la dernière
+// passe (une multiplication-addition par pixel) reste en pleine résolution.
+
+namespace matte {
+
+struct RefineParams {
+    int radius = 8;       // rayon du filtre en pixels pleine résolution
+    double eps = 1e-3;    // régularisation (intensités normalisées 0..1)
+    int factor = 4;       // facteur de réduction
+};
+
+// Buffers réutilisés d'un appel à l'autre (un jeu par worker et par overlay)
+struct RefineScratch {
+    cv::Mat gray, small8, smallI, smallP, meanI, meanP, corrII, corrIP, tmp, a, b, meanA, meanB, bigA, bigB;
+};
+
+// Temps passé dans le raffinement, cumulé par tous les threads
+struct RefineStats {
+    std::atomic<long long> nanoseconds{0};
+    std::atomic<long long> frames{0};
+
+    double totalMs() const { return nanoseconds.load() / 1e6; }
+    double msPerFrame() const { return frames.load() ? totalMs() / frames.load() : 0.0; }
+};
+
+// Affine `alpha` (CV_8UC1, modifié sur place) en suivant les contours de `guide` (BGR ou BGRA).
+inline void refine(const cv::Mat& guide, cv::Mat& alpha, const RefineParams& p, RefineScratch& s) {
+    CV_Assert(guide.size() == alpha.size() && alpha.type() == CV_8UC1);
+
+    if (guide.channels() == 4) {
+        cv::cvtColor(guide, s.gray, cv::COLOR_BGRA2GRAY);
+    } else if (guide.channels() == 3) {
+        cv::cvtColor(guide, s.gray, cv::COLOR_BGR2GRAY);
+    } else {
+        guide.copyTo(s.gray);
+    }
+
+    const int f = std::max(1, p.factor);
+    const cv::Size small(std::max(1, alpha.cols / f), std::max(1, alpha.rows / f));
+    const int r = std::max(1, p.radius / f);
+    const cv::Size k(2 * r + 1, 2 * r + 1);
+
+    cv::resize(s.gray, s.small8, small, 0, 0, cv::INTER_AREA);
+    s.small8.convertTo(s.smallI, CV_32F, 1.0 / 255.0);
+    cv::resize(alpha, s.small8, small, 0, 0, cv::INTER_AREA);
+    s.small8.convertTo(s.smallP, CV_32F, 1.0 / 255.0);
+
+    cv::boxFilter(s.smallI, s.meanI, CV_32F, k);
+    cv::boxFilter(s.smallP, s.meanP, CV_32F, k);
+    cv::multiply(s.smallI, s.smallI, s.tmp);
+    cv::boxFilter(s.tmp, s.corrII, CV_32F, k);
+    cv::multiply(s.smallI, s.smallP, s.tmp);
+    cv::boxFilter(s.tmp, s.corrIP, CV_32F, k);
+
+    // a = cov(I, p) / (var(I) + eps), b = mean(p) - a * mean(I)
+    s.a.create(small, CV_32F);
+    s.b.create(small, CV_32F);
+    const float eps = static_cast<float>(p.eps);
+    for (int y = 0; y < small.height; y++) {
+        const float* mI = s.meanI.ptr<float>(y);
+        const float* mP = s.meanP.ptr<float>(y);
+        const float* cII = s.corrII.ptr<float>(y);
+        const float* cIP = s.corrIP.ptr<float>(y);
+        float* a = s.a.ptr<float>(y);
+        float* b = s.b.ptr<float>(y);
+        for (int x = 0; x < small.width; x++) {
+            float varI = cII[x] - mI[x] * mI[x];
+            float covIP = cIP[x] - mI[x] * mP[x];
+            a[x] = covIP / (varI + eps);
+            b[x] = mP[x] - a[x] * mI[x];
+        }
+    }
+    cv::boxFilter(s.a, s.meanA, CV_32F, k);
+    cv::boxFilter(s.b, s.meanB, CV_32F, k);
+    cv::resize(s.meanA, s.bigA, alpha.size(), 0, 0, cv::INTER_LINEAR);
+    cv::resize(s.meanB, s.bigB, alpha.size(), 0, 0, cv::INTER_LINEAR);
+
+    // Seule passe en pleine résolution
+    for (int y = 0; y < alpha.rows; y++) {
+        const uchar* g = s.gray.ptr<uchar>(y);
+        const float* a = s.bigA.ptr<float>(y);
+        const float* b = s.bigB.ptr<float>(y);
+        uchar* out = alpha.ptr<uchar>(y);
+        for (int x = 0; x < alpha.cols; x++) {
+            out[x] = cv::saturate_cast<uchar>((a[x] * g[x] + b[x] * 255.f));
+        }
+    }
+}
+
+// refine() chronométré dans `stats`
+inline void refineTimed(const cv::Mat& guide, cv::Mat& alpha, const RefineParams& p, RefineScratch& s,
+                        RefineStats& stats) {
+    auto start = std::chrono::steady_clock::now();
+    refine(guide, alpha, p, s);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    stats.nanoseconds += ns;
+    stats.frames++;
+}
+
+} // namespace matte
+
+#endif // MATTE_REFINE_H
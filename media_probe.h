@@ -0,0 +1,263 @@
+#ifndef MEDIA_PROBE_H
+#define MEDIA_PROBE_H
+
+#include <opencv2/opencv.hpp>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+#ifdef HAVE_LIBAV
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#endif
+
+// Analyse rapide d'un fichier média : nombre exact de frames, plage de PTS,
+// positions des keyframes et liste des flux, sans décoder une seule image.
+//
+// CAP_PROP_FRAME_COUNT n'est qu'une estimation pour beaucoup de conteneurs
+// (durée x fps) : alignement « end » et pourcentages de progression faux.
+// Avec libav (HAVE_LIBAV), on lit dans l'ordre :
+//   1. l'index du conteneur (MP4/MOV : une entrée par échantillon), seulement
+//      sans réordonnancement : ses horodatages sont des DTS, et avec des
+//      B-frames leur ordre n'est pas celui de présentation ;
+//   2. sinon, un démultiplexage paquet par paquet du seul flux vidéo, les
+//      autres flux étant ignorés par le démultiplexeur (AVDISCARD_ALL), qui
+//      donne les PTS (décalages CTTS appliqués).
+// Sans libav, on retombe sur les propriétés de cv::VideoCapture (estimation).
+//
+// Le résultat est mis en cache dans un fichier voisin "<fichier>.probe.json",
+// invalidé si la taille ou la date de modification du fichier changent.
+
+namespace probe {
+
+struct MediaInfo {
+    bool valid = false;
+    bool exact = false;             // frames comptées (index ou démultiplexage)
+    std::string method;             // "index", "demux" ou "opencv"
+    int width = 0;
+    int height = 0;
+    double fps = 0.0;
+    long long frameCount = 0;
+    double startTime = 0.0;         // PTS de la première frame (s)
+    double duration = 0.0;          // de la première frame à la fin de la dernière (s)
+    std::vector<long long> keyframes;  // index des keyframes, ordre de présentation
+    int videoStreams = 0;
+    int audioStreams = 0;
+    int subtitleStreams = 0;
+
+    bool hasAudio() const { return audioStreams > 0; }
+    int frames() const { return static_cast<int>(std::min<long long>(frameCount, 0x7fffffff)); }
+
+    // Keyframe la plus proche avant (ou sur) `frame`, 0 si inconnue
+    long long keyframeBefore(long long frame) const {
+        auto it = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+        return it == keyframes.begin() ? 0 : *(it - 1);
+    }
+};
+
+namespace detail {
+
+// Version du cache voisin : la 1 pouvait contenir des keyframes en ordre de décodage
+const int kSidecarVersion = 2;
+
+// Identité du fichier pour valider le cache : taille + date de modification
+inline bool fileStamp(const std::string& path, long long& size, long long& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = static_cast<long long>(st.st_size);
+    mtime = static_cast<long long>(st.st_mtime);
+    return true;
+}
+
+inline std::string sidecarPath(const std::string& path) {
+    return path + ".probe.json";
+}
+
+inline nlohmann::json toJson(const MediaInfo& m, long long size, long long mtime) {
+    nlohmann::json j;
+    j["version"] = kSidecarVersion;
+    j["size"] = size;
+    j["mtime"] = mtime;
+    j["exact"] = m.exact;
+    j["method"] = m.method;
+    j["width"] = m.width;
+    j["height"] = m.height;
+    j["fps"] = m.fps;
+    j["frames"] = m.frameCount;
+    j["start"] = m.startTime;
+    j["duration"] = m.duration;
+    j["keyframes"] = m.keyframes;
+    j["streams"] = { { "video", m.videoStreams }, { "audio", m.audioStreams },
+                     { "subtitle", m.subtitleStreams } };
+    return j;
+}
+
+inline bool loadSidecar(const std::string& path, long long size, long long mtime, MediaInfo& m) {
+    std::ifstream f(sidecarPath(path));
+    if (!f.is_open()) return false;
+    try {
+        nlohmann::json j;
+        f >> j;
+        if (j.value("version", 0) != kSidecarVersion || j.value("size", -1LL) != size || j.value("mtime", -1LL) != mtime) {
+            return false;
+        }
+        m.exact = j.value("exact", false);
+        m.method = j.value("method", std::string());
+        m.width = j.value("width", 0);
+        m.height = j.value("height", 0);
+        m.fps = j.value("fps", 0.0);
+        m.frameCount = j.value("frames", 0LL);
+        m.startTime = j.value("start", 0.0);
+        m.duration = j.value("duration", 0.0);
+        m.keyframes = j.value("keyframes", std::vector<long long>());
+        const nlohmann::json& s = j.at("streams");
+        m.videoStreams = s.value("video", 0);
+        m.audioStreams = s.value("audio", 0);
+        m.subtitleStreams = s.value("subtitle", 0);
+        m.valid = true;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+inline void saveSidecar(const std::string& path, long long size, long long mtime, const MediaInfo& m) {
+    std::ofstream f(sidecarPath(path));
+    if (f.is_open()) f << toJson(m, size, mtime).dump();  // dossier en lecture seule : pas de cache
+}
+
+inline bool probeOpenCV(const std::string& path, MediaInfo& m) {
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened()) return false;
+    m.width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    m.height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    m.fps = cap.get(cv::CAP_PROP_FPS);
+    m.frameCount = static_cast<long long>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+    m.duration = m.fps > 0 ? m.frameCount / m.fps : 0.0;
+    m.videoStreams = 1;
+    m.method = "opencv";
+    m.exact = false;
+    m.valid = true;
+    return true;
+}
+
+#ifdef HAVE_LIBAV
+// Index des keyframes en ordre de présentation à partir de (pts, keyframe) en ordre de décodage
+inline void finishFromPackets(std::vector<std::pair<int64_t, bool>>& packets, AVStream* st, MediaInfo& m) {
+    std::sort(packets.begin(), packets.end(),
+              [](const std::pair<int64_t, bool>& a, const std::pair<int64_t, bool>& b) { return a.first < b.first; });
+    m.frameCount = static_cast<long long>(packets.size());
+    m.keyframes.clear();
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (packets[i].second) m.keyframes.push_back(static_cast<long long>(i));
+    }
+    if (!packets.empty()) {
+        double tb = av_q2d(st->time_base);
+        m.startTime = packets.front().first * tb;
+        double frameDur = m.fps > 0 ? 1.0 / m.fps : 0.0;
+        m.duration = (packets.back().first - packets.front().first) * tb + frameDur;
+    }
+}
+
+inline bool probeLibav(const std::string& path, MediaInfo& m) {
+    AVFormatContext* fmt = nullptr;
+    if (avformat_open_input(&fmt, path.c_str(), nullptr, nullptr) < 0) return false;
+    if (avformat_find_stream_info(fmt, nullptr) < 0) {
+        avformat_close_input(&fmt);
+        return false;
+    }
+
+    for (unsigned i = 0; i < fmt->nb_streams; i++) {
+        switch (fmt->streams[i]->codecpar->codec_type) {
+            case AVMEDIA_TYPE_VIDEO: m.videoStreams++; break;
+            case AVMEDIA_TYPE_AUDIO: m.audioStreams++; break;
+            case AVMEDIA_TYPE_SUBTITLE: m.subtitleStreams++; break;
+            default: break;
+        }
+    }
+    int vs = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (vs < 0) {
+        avformat_close_input(&fmt);
+        return false;
+    }
+    AVStream* st = fmt->streams[vs];
+    m.width = st->codecpar->width;
+    m.height = st->codecpar->height;
+    AVRational rate = st->avg_frame_rate.num ? st->avg_frame_rate : st->r_frame_rate;
+    m.fps = rate.num && rate.den ? av_q2d(rate) : 0.0;
+
+    std::vector<std::pair<int64_t, bool>> packets;
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 76, 100)
+    // 1. Index du conteneur : MP4/MOV indexent chaque échantillon, horodaté en DTS.
+    //    Avec des B-frames (video_delay > 0), trier ces DTS ne donne pas l'ordre de
+    //    présentation : keyframes et numéros de frame seraient décalés.
+    int entries = avformat_index_get_entries_count(st);
+    if (entries > 0 && st->codecpar->video_delay == 0
+        && std::string(fmt->iformat->name).find("mov") != std::string::npos) {
+        packets.reserve(entries);
+        for (int i = 0; i < entries; i++) {
+            const AVIndexEntry* e = avformat_index_get_entry(st, i);
+            if (e->flags & AVINDEX_DISCARD_FRAME) continue;
+            packets.emplace_back(e->timestamp, (e->flags & AVINDEX_KEYFRAME) != 0);
+        }
+        m.method = "index";
+    }
+#endif
+
+    // 2. Démultiplexage sans décodage, flux vidéo seul
+    if (packets.empty()) {
+        for (unsigned i = 0; i < fmt->nb_streams; i++) {
+            if (static_cast<int>(i) != vs) fmt->streams[i]->discard = AVDISCARD_ALL;
+        }
+        AVPacket* pkt = av_packet_alloc();
+        while (pkt && av_read_frame(fmt, pkt) >= 0) {
+            if (pkt->stream_index == vs) {
+                int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+                packets.emplace_back(pts, (pkt->flags & AV_PKT_FLAG_KEY) != 0);
+            }
+            av_packet_unref(pkt);
+        }
+        av_packet_free(&pkt);
+        m.method = "demux";
+    }
+
+    finishFromPackets(packets, st, m);
+    m.exact = !packets.empty();
+    m.valid = true;
+    avformat_close_input(&fmt);
+    return true;
+}
+#endif
+
+} // namespace detail
+
+// Informations sur `path`, depuis le cache voisin si valide.
+inline MediaInfo probe(const std::string& path, bool useCache = true) {
+    MediaInfo m;
+    long long size = 0, mtime = 0;
+    bool stamped = detail::fileStamp(path, size, mtime);
+    if (useCache && stamped && detail::loadSidecar(path, size, mtime, m)) return m;
+
+    bool ok = false;
+#ifdef HAVE_LIBAV
+    ok = detail::probeLibav(path, m);
+#endif
+    if (!ok) {
+        m = MediaInfo();
+        ok = detail::probeOpenCV(path, m);
+    }
+    // Seuls les comptages exacts valent la peine d'être mis en cache
+    if (ok && m.exact && useCache && stamped) detail::saveSidecar(path, size, mtime, m);
+    return m;
+}
+
+} // namespace probe
+
+#endif // MEDIA_PROBE_H
@@ -2,6 +2,22 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "chroma_key.h"
+#include "lut_keyer.h"
+#include "composite.h"
+#include "media_probe.h"
+#include "av_muxer.h"
+#include "sprite_cache.h"
 
 using namespace cv;
 using namespace std;
@@ -23,9 +39,18 @@ struct Config {
     Vec3b chromaKey = Vec3b(0, 255, 0); // Vert par défaut
     bool useChromaKey = false;
     int chromaTolerance = 40;
+    int chromaSoftness = 0; // 0 = masque binaire
+    bool lutKeyer = false;  // keyer YCbCr précompilé en table 3D (--keyer lut)
+    float despill = 1.0f;   // suppression du débordement (keyer lut)
     double overlayScale = 1.0;
     double opacity = 1.0; // 0.0 à 1.0
     bool useAlphaChannel = true; // Utiliser le canal alpha du PNG si disponible
+    bool verbose = false;
+    string batch;                       // manifeste ou dossier de vidéos (mode batch)
+    string batchOutDir = "watermarked"; // dossier des sorties du batch
+    int threads = 0;                    // budget de threads (0 = nombre de coeurs)
+    double animFps = 0.0;               // cadence imposée de l'animation (0 = celle du fichier)
+    int animCacheMB = 512;              // budget mémoire des sprites de l'animation
 };
 
 void printUsage(const char* progName) {
@@ -37,6 +62,11 @@ void printUsage(const char* progName) {
          << "  -i, --image <file>         Image à incruster (requise)\n"
          << "\nOptions de sortie:\n"
          << "  -out, --output <file>      Vidéo de sortie (défaut: output.avi)\n"
+         << "\nMode batch (remplace -v / -out):\n"
+         << "  -b, --batch <file|dir>     Manifeste (une vidéo par ligne, sortie optionnelle après une\n"
+         << "                             tabulation) ou dossier de vidéos ; l'image n'est préparée qu'une fois\n"
+         << "  --batch-out <dir>          Dossier des sorties (défaut: watermarked)\n"
+         << "  -j, --threads <n>          Budget global de threads (défaut: nombre de coeurs)\n"
          << "\nOptions de positionnement:\n"
          << "  -p, --position <pos>       Position: topleft|topright|bottomleft|bottomright|center|custom\n"
          << "                             (défaut: topleft)\n"
@@ -52,8 +82,15 @@ void printUsage(const char* progName) {
          << "  -op, --opacity <float>     Opacité de l'image: 0.0 (transparent) à 1.0 (opaque)\n"
          << "  -c, --chroma <r,g,b>       Activer chroma key avec couleur RGB (ex: 0,255,0)\n"
          << "  -t, --tolerance <val>      Tolérance du chroma key (défaut: 40)\n"
+         << "  -sf, --softness <val>      Largeur de la rampe douce du chroma key (défaut: 0 = binaire)\n"
+         << "  --keyer <l1|lut>           Modèle du chroma key: distance BGR (l1) ou table 3D YCbCr (lut)\n"
+         << "  --despill <0..1>           Suppression du débordement de couleur (keyer lut, défaut: 1)\n"
          << "  --no-alpha                 Ignorer le canal alpha du PNG\n"
+         << "\nOptions d'animation (GIF, APNG, WebP animé, séquence logo_%04d.png):\n"
+         << "  --anim-fps <fps>           Cadence imposée (défaut: durées du fichier, 25 pour une séquence)\n"
+         << "  --anim-cache <Mo>          Budget mémoire des sprites pré-décodés (défaut: 512)\n"
          << "\nAutres:\n"
+         << "  --verbose                  Statistiques du masque (part de pixels partiels)\n"
          << "  -h, --help                 Afficher cette aide\n"
          << "\nExemples:\n"
          << "  # Logo en haut à droite, toute la vidéo\n"
@@ -63,7 +100,12 @@ void printUsage(const char* progName) {
          << "\n  # Image avec fond vert transparent, de 5s à 15s\n"
          << "  " << progName << " -v video.mp4 -i image.jpg -c 0,255,0 -ts 5 -d 300\n"
          << "\n  # Image à position spécifique, apparaît à la frame 100\n"
-         << "  " << progName << " -v video.mp4 -i overlay.png -p custom -x 50 -y 100 -f 100\n";
+         << "  " << progName << " -v video.mp4 -i overlay.png -p custom -x 50 -y 100 -f 100\n"
+         << "\n  # Logo animé (APNG ou séquence PNG) avec vrai canal alpha, en boucle\n"
+         << "  " << progName << " -v video.mp4 -i logo.apng -p topright -s 0.5\n"
+         << "  " << progName << " -v video.mp4 -i logo_%04d.png --anim-fps 30 -p bottomright\n"
+         << "\n  # Même logo sur tout un dossier, 16 threads au total\n"
+         << "  " << progName << " -b clips/ -i logo.png -p topright -s 0.3 --batch-out stamped/ -j 16\n";
 }
 
 bool parseArgs(int argc, char** argv, Config& cfg) {
@@ -147,6 +189,29 @@ bool parseArgs(int argc, char** argv, Config& cfg) {
         else if ((arg == "-t" || arg == "--tolerance") && i + 1 < argc) {
             cfg.chromaTolerance = stoi(argv[++i]);
         }
+        else if ((arg == "-sf" || arg == "--softness") && i + 1 < argc) {
+            cfg.chromaSoftness = stoi(argv[++i]);
+            if (cfg.chromaSoftness < 0) {
+                cerr << "La douceur doit être positive ou nulle\n";
+                return false;
+            }
+        }
+        else if (arg == "--keyer" && i + 1 < argc) {
+            string keyer = argv[++i];
+            if (keyer == "lut") cfg.lutKeyer = true;
+            else if (keyer == "l1") cfg.lutKeyer = false;
+            else {
+                cerr << "Keyer invalide: " << keyer << " (l1 ou lut)\n";
+                return false;
+            }
+        }
+        else if (arg == "--despill" && i + 1 < argc) {
+            cfg.despill = stof(argv[++i]);
+            if (cfg.despill < 0.0f || cfg.despill > 1.0f) {
+                cerr << "Le despill doit être entre 0.0 et 1.0\n";
+                return false;
+            }
+        }
         else if ((arg == "-s" || arg == "--scale") && i + 1 < argc) {
             cfg.overlayScale = stod(argv[++i]);
             if (cfg.overlayScale <= 0) {
@@ -164,9 +229,31 @@ bool parseArgs(int argc, char** argv, Config& cfg) {
         else if (arg == "--no-alpha") {
             cfg.useAlphaChannel = false;
         }
+        else if (arg == "--verbose") {
+            cfg.verbose = true;
+        }
+        else if (arg == "--anim-fps" && i + 1 < argc) {
+            cfg.animFps = stod(argv[++i]);
+            if (cfg.animFps < 0) {
+                cerr << "La cadence de l'animation doit être positive\n";
+                return false;
+            }
+        }
+        else if (arg == "--anim-cache" && i + 1 < argc) {
+            cfg.animCacheMB = max(1, stoi(argv[++i]));
+        }
+        else if ((arg == "-b" || arg == "--batch") && i + 1 < argc) {
+            cfg.batch = argv[++i];
+        }
+        else if (arg == "--batch-out" && i + 1 < argc) {
+            cfg.batchOutDir = argv[++i];
+        }
+        else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            cfg.threads = max(0, stoi(argv[++i]));
+        }
     }
     
-    if (cfg.mainVideo.empty() || cfg.overlayImage.empty()) {
+    if ((cfg.mainVideo.empty() && cfg.batch.empty()) || cfg.overlayImage.empty()) {
         cerr << "Erreur: La vidéo et l'image sont requises!\n\n";
         printUsage(argv[0]);
         return false;
@@ -197,26 +284,24 @@ Point calculatePosition(Position pos, int mainW, int mainH, int overlayW, int ov
     return Point(0, 0);
 }
 
-Mat createMaskFromChromaKey(const Mat& image, const Vec3b& chromaKey, int tolerance) {
-    Mat mask(image.rows, image.cols, CV_8UC1);
-    
-    for (int y = 0; y < image.rows; y++) {
-        for (int x = 0; x < image.cols; x++) {
-            Vec3b pixel = image.at<Vec3b>(y, x);
-            
-            // Calculer la distance de couleur
-            int diff = abs(pixel[0] - chromaKey[0]) + 
-                      abs(pixel[1] - chromaKey[1]) + 
-                      abs(pixel[2] - chromaKey[2]);
-            
-            if (diff < tolerance * 3) {
-                mask.at<uchar>(y, x) = 0; // Transparent
-            } else {
-                mask.at<uchar>(y, x) = 255; // Opaque
-            }
-        }
-    }
-    
+Mat createMaskFromChromaKey(const Mat& image, const Vec3b& chromaKey, int tolerance, int softness) {
+    Mat mask;
+    chroma::computeMatte(image, mask, chromaKey, tolerance, softness);
+    return mask;
+}
+
+// Variante table 3D YCbCr : corrige aussi le débordement de couleur dans `image`
+Mat createMaskFromLutKeyer(Mat& image, const Config& cfg) {
+    chroma::LutKeyParams params;
+    params.key = cfg.chromaKey;
+    params.tolerance = cfg.chromaTolerance;
+    params.softness = cfg.chromaSoftness;
+    params.despill = cfg.despill;
+    
+    chroma::LutKeyer keyer;
+    keyer.build(params);
+    Mat mask;
+    keyer.apply(image, mask);
     return mask;
 }
 
@@ -230,77 +315,23 @@ Mat extractAlphaChannel(const Mat& image) {
     return Mat::ones(image.rows, image.cols, CV_8UC1) * 255;
 }
 
-void overlayImageWithMask(Mat& background, const Mat& foreground, const Mat& mask, Point position, double opacity) {
-    for (int y = 0; y < foreground.rows; y++) {
-        for (int x = 0; x < foreground.cols; x++) {
-            int bgX = position.x + x;
-            int bgY = position.y + y;
-            
-            if (bgX >= 0 && bgX < background.cols && bgY >= 0 && bgY < background.rows) {
-                double alpha = (mask.at<uchar>(y, x) / 255.0) * opacity;
-                
-                if (alpha > 0) {
-                    Vec3b fgPixel = foreground.at<Vec3b>(y, x);
-                    Vec3b& bgPixel = background.at<Vec3b>(bgY, bgX);
-                    
-                    // Blending avec alpha
-                    bgPixel[0] = static_cast<uchar>(fgPixel[0] * alpha + bgPixel[0] * (1.0 - alpha));
-                    bgPixel[1] = static_cast<uchar>(fgPixel[1] * alpha + bgPixel[1] * (1.0 - alpha));
-                    bgPixel[2] = static_cast<uchar>(fgPixel[2] * alpha + bgPixel[2] * (1.0 - alpha));
-                }
-            }
-        }
-    }
-}
-
-int main(int argc, char** argv) {
-    Config cfg;
-    
-    if (!parseArgs(argc, argv, cfg)) {
-        return 1;
-    }
-    
-    cout << "=== Merge Image to Video ===\n\n";
-    
-    // Ouvrir la vidéo
-    VideoCapture cap(cfg.mainVideo);
-    
-    if (!cap.isOpened()) {
-        cerr << "Erreur: Impossible d'ouvrir la vidéo: " << cfg.mainVideo << endl;
-        return 1;
-    }
-    
-    // Récupérer les propriétés de la vidéo
-    int videoW = static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH));
-    int videoH = static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
-    double fps = cap.get(CAP_PROP_FPS);
-    int frameCount = static_cast<int>(cap.get(CAP_PROP_FRAME_COUNT));
-    
-    cout << "Vidéo: " << videoW << "x" << videoH << " @ " << fps << " fps, " 
-         << frameCount << " frames\n";
-    
-    // Charger l'image
-    Mat originalImage = imread(cfg.overlayImage, IMREAD_UNCHANGED);
-    
-    if (originalImage.empty()) {
-        cerr << "Erreur: Impossible de charger l'image: " << cfg.overlayImage << endl;
-        return 1;
-    }
-    
-    cout << "Image: " << originalImage.cols << "x" << originalImage.rows 
-         << ", " << originalImage.channels() << " canaux\n";
-    
+// Prépare une image décodée (BGR ou BGRA) : alpha extrait, redimensionnée,
+// chroma key appliqué puis prémultipliée. log : afficher les étapes.
+void prepareSprite(const Config& cfg, const Mat& originalImage, composite::PremultipliedOverlay& overlay, bool log) {
     // Convertir en BGR si nécessaire et extraire le canal alpha
     Mat imageRGB, imageMask;
     
     if (originalImage.channels() == 4) {
         if (cfg.useAlphaChannel) {
             imageMask = extractAlphaChannel(originalImage);
-            cout << "Utilisation du canal alpha de l'image\n";
+            if (log) cout << "Utilisation du canal alpha de l'image\n";
         } else {
             imageMask = Mat::ones(originalImage.rows, originalImage.cols, CV_8UC1) * 255;
         }
         cvtColor(originalImage, imageRGB, COLOR_BGRA2BGR);
+    } else if (originalImage.channels() == 1) {
+        cvtColor(originalImage, imageRGB, COLOR_GRAY2BGR);
+        imageMask = Mat::ones(originalImage.rows, originalImage.cols, CV_8UC1) * 255;
     } else {
         imageRGB = originalImage.clone();
         imageMask = Mat::ones(originalImage.rows, originalImage.cols, CV_8UC1) * 255;
@@ -315,25 +346,139 @@ int main(int argc, char** argv) {
         resize(imageMask, imageMask, Size(overlayW, overlayH));
     }
     
-    cout << "Taille finale de l'image: " << overlayW << "x" << overlayH << "\n";
+    if (log) cout << "Taille finale de l'image: " << overlayW << "x" << overlayH << "\n";
     
     // Appliquer le chroma key si demandé
     if (cfg.useChromaKey) {
-        Mat chromaMask = createMaskFromChromaKey(imageRGB, cfg.chromaKey, cfg.chromaTolerance);
+        Mat chromaMask = cfg.lutKeyer
+            ? createMaskFromLutKeyer(imageRGB, cfg)
+            : createMaskFromChromaKey(imageRGB, cfg.chromaKey, cfg.chromaTolerance, cfg.chromaSoftness);
         // Combiner avec le masque existant
         bitwise_and(imageMask, chromaMask, imageMask);
-        cout << "Chroma key activé: RGB(" << (int)cfg.chromaKey[2] << "," 
-             << (int)cfg.chromaKey[1] << "," << (int)cfg.chromaKey[0] << ")\n";
+        if (log) {
+            cout << "Chroma key activé: RGB(" << (int)cfg.chromaKey[2] << "," 
+                 << (int)cfg.chromaKey[1] << "," << (int)cfg.chromaKey[0] << ")\n";
+        }
+    }
+    
+    if (log && cfg.opacity < 1.0) {
+        cout << "Opacité: " << (cfg.opacity * 100) << "%\n";
+    }
+    
+    // L'image, le masque et l'opacité ne changent pas : prémultiplication une fois pour toutes
+    composite::precompute(imageRGB, imageMask, cfg.opacity, overlay);
+    if (log && cfg.verbose) {
+        typedef composite::PremultipliedOverlay P;
+        cout << "Masque: " << (overlay.fraction(P::TRANSPARENT) * 100) << "% transparent, "
+             << (overlay.fraction(P::OPAQUE) * 100) << "% opaque, "
+             << (overlay.fraction(P::PARTIAL) * 100) << "% partiel ("
+             << overlay.runs.size() << " segments)\n";
+    }
+}
+
+// Overlay prêt à incruster : image fixe (un sprite) ou animation (GIF, APNG,
+// WebP, séquence PNG) décodée une fois en sprites. Ne dépend pas de la vidéo :
+// en mode batch, il est préparé une seule fois et partagé en lecture seule par
+// tous les fichiers.
+bool prepareOverlay(const Config& cfg, sprite::SpriteSheet& sprites) {
+    if (sprite::isAnimationPath(cfg.overlayImage)) {
+        bool log = true;  // étapes affichées pour la première frame seulement
+        auto prepare = [&](const Mat& image, composite::PremultipliedOverlay& out) {
+            prepareSprite(cfg, image, out, log);
+            log = false;
+        };
+        size_t maxBytes = static_cast<size_t>(cfg.animCacheMB) << 20;
+        if (sprites.load(cfg.overlayImage, cfg.animFps, cfg.animFps > 0, maxBytes, prepare)) {
+            cout << "Animation: " << sprites.sourceFrames() << " frames, " << sprites.duration() << "s par boucle"
+                 << (sprites.loops() > 0 ? ", " + to_string(sprites.loops()) + " boucle(s)" : ", en boucle")
+                 << ", " << sprites.sprites() << " sprites (" << (sprites.bytes() >> 20) << " Mo)\n";
+            if (sprites.step() > 1) {
+                cout << "⚠ Budget mémoire dépassé: une frame sur " << sprites.step()
+                     << " gardée (--anim-cache pour l'augmenter)\n";
+            }
+            return true;
+        }
+    }
+    
+    // Charger l'image
+    Mat originalImage = imread(cfg.overlayImage, IMREAD_UNCHANGED);
+    
+    if (originalImage.empty()) {
+        cerr << "Erreur: Impossible de charger l'image: " << cfg.overlayImage << endl;
+        return false;
+    }
+    
+    cout << "Image: " << originalImage.cols << "x" << originalImage.rows 
+         << ", " << originalImage.channels() << " canaux\n";
+    
+    composite::PremultipliedOverlay overlay;
+    prepareSprite(cfg, originalImage, overlay, true);
+    sprites.setStatic(std::move(overlay));
+    return true;
+}
+
+// Résultat d'un fichier traité
+struct JobStats {
+    string input;
+    string output;
+    string error;
+    Size size;
+    int frames = 0;
+    double seconds = 0.0;
+    
+    double fps() const { return seconds > 0 ? frames / seconds : 0.0; }
+    double megapixelsPerSecond() const { return fps() * size.area() / 1e6; }
+};
+
+// Incruste l'overlay précalculé (fixe ou animé) dans `input` et écrit `output`.
+// threads : threads du décodeur, et autant pour l'encodeur, de ce fichier (0 = automatique).
+// quiet : pas d'affichage (mode batch, le résumé est imprimé par l'appelant).
+bool processVideo(const Config& cfg, const string& input, const string& output,
+                  const sprite::SpriteSheet& sprites, int threads, bool quiet, JobStats& stats) {
+    auto started = chrono::steady_clock::now();
+    stats.input = input;
+    stats.output = output;
+    
+    // Ouvrir la vidéo (décodeur limité à sa part du budget de threads)
+    VideoCapture cap;
+#if CV_VERSION_MAJOR * 100 + CV_VERSION_MINOR >= 406
+    if (threads > 0) cap.open(input, CAP_ANY, { CAP_PROP_N_THREADS, threads });
+#endif
+    if (!cap.isOpened()) cap.open(input);
+    
+    if (!cap.isOpened()) {
+        stats.error = "Impossible d'ouvrir la vidéo";
+        if (!quiet) cerr << "Erreur: Impossible d'ouvrir la vidéo: " << input << endl;
+        return false;
+    }
+    
+    // Récupérer les propriétés de la vidéo
+    int videoW = static_cast<int>(cap.get(CAP_PROP_FRAME_WIDTH));
+    int videoH = static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
+    double fps = cap.get(CAP_PROP_FPS);
+    int frameCount = static_cast<int>(cap.get(CAP_PROP_FRAME_COUNT));
+    stats.size = Size(videoW, videoH);
+    
+    // Nombre de frames exact plutôt que l'estimation de CAP_PROP_FRAME_COUNT
+    probe::MediaInfo info = probe::probe(input);
+    if (info.exact) frameCount = info.frames();
+    if (info.fps > 0.0) fps = info.fps;
+    
+    if (!quiet) {
+        cout << "Vidéo: " << videoW << "x" << videoH << " @ " << fps << " fps, " 
+             << frameCount << " frames" << (info.exact ? "" : " (estimation)") << "\n";
     }
     
     // Calculer la position
-    Point overlayPos = calculatePosition(cfg.position, videoW, videoH, overlayW, overlayH, 
+    const Size overlaySize = sprites.first().color.size();
+    Point overlayPos = calculatePosition(cfg.position, videoW, videoH, overlaySize.width, overlaySize.height, 
                                         cfg.customX, cfg.customY);
-    cout << "Position: (" << overlayPos.x << ", " << overlayPos.y << ")\n";
+    if (!quiet) cout << "Position: (" << overlayPos.x << ", " << overlayPos.y << ")\n";
     
     // Calculer le timing
     int startFrame = 0;
     int endFrame = frameCount;
+    string timing;
     
     switch (cfg.timeAlign) {
         case TimeAlign::START:
@@ -341,17 +486,17 @@ int main(int argc, char** argv) {
             if (cfg.duration > 0) {
                 endFrame = min(startFrame + cfg.duration, frameCount);
             }
-            cout << "Timing: Début (frames " << startFrame << " à " << endFrame << ")\n";
+            timing = "Début (frames " + to_string(startFrame) + " à " + to_string(endFrame) + ")";
             break;
-            
+        
         case TimeAlign::END:
             if (cfg.duration > 0) {
                 startFrame = max(0, frameCount - cfg.duration);
             }
             endFrame = frameCount;
-            cout << "Timing: Fin (frames " << startFrame << " à " << endFrame << ")\n";
+            timing = "Fin (frames " + to_string(startFrame) + " à " + to_string(endFrame) + ")";
             break;
-            
+        
         case TimeAlign::FRAME:
             startFrame = cfg.startFrame;
             if (startFrame < 0) startFrame = 0;
@@ -360,10 +505,10 @@ int main(int argc, char** argv) {
             if (cfg.duration > 0) {
                 endFrame = min(startFrame + cfg.duration, frameCount);
             }
-            cout << "Timing: Frame " << startFrame << " à " << endFrame << "\n";
+            timing = "Frame " + to_string(startFrame) + " à " + to_string(endFrame);
             break;
-            
-        case TimeAlign::TIMESTAMP:
+        
+        case TimeAlign::TIMESTAMP: {
             startFrame = static_cast<int>(cfg.startTimestamp * fps);
             if (startFrame < 0) startFrame = 0;
             if (startFrame > frameCount) startFrame = frameCount;
@@ -371,77 +516,212 @@ int main(int argc, char** argv) {
             if (cfg.duration > 0) {
                 endFrame = min(startFrame + cfg.duration, frameCount);
             }
-            cout << "Timing: " << cfg.startTimestamp << "s (frames " 
-                 << startFrame << " à " << endFrame << ")\n";
+            ostringstream ts;
+            ts << cfg.startTimestamp << "s (frames " << startFrame << " à " << endFrame << ")";
+            timing = ts.str();
             break;
+        }
     }
-    
-    if (cfg.opacity < 1.0) {
-        cout << "Opacité: " << (cfg.opacity * 100) << "%\n";
+    if (!quiet) cout << "Timing: " << timing << "\n";
+    
+    // Créer le writer : vidéo encodée et audio de la source copié en un seul passage
+    MediaWriter writer;
+    writer.setThreads(threads);
+    if (!writer.open(output, fps, Size(videoW, videoH), input)) {
+        stats.error = "Impossible de créer la vidéo de sortie";
+        if (!quiet) cerr << "Erreur: Impossible de créer la vidéo de sortie\n";
+        return false;
     }
-    
-    // Créer le writer
-    VideoWriter writer(cfg.outputVideo, 
-                      VideoWriter::fourcc('M','J','P','G'),
-                      fps,
-                      Size(videoW, videoH));
-    
-    if (!writer.isOpened()) {
-        cerr << "Erreur: Impossible de créer la vidéo de sortie\n";
-        return 1;
+    if (!quiet) {
+        cout << "Sortie: " << output << " (" << writer.codecName()
+             << (writer.hasAudio() ? ", audio copié" : ", sans audio") << ")\n";
+        cout << "\nTraitement en cours...\n";
     }
     
-    cout << "\nTraitement en cours...\n";
-    
     Mat frame;
     int frameNum = 0;
     
     while (cap.read(frame)) {
         // Appliquer l'overlay si on est dans la fenêtre temporelle
         if (frameNum >= startFrame && frameNum < endFrame) {
-            overlayImageWithMask(frame, imageRGB, imageMask, overlayPos, cfg.opacity);
+            // Animation : temps écoulé depuis l'apparition de l'overlay
+            const composite::PremultipliedOverlay& overlay = sprites.at((frameNum - startFrame) / fps);
+            composite::overlayPrecomputed(frame, overlay, overlayPos);
         }
         
-        writer.write(frame);
+        if (!writer.write(frame)) {
+            stats.error = "Écriture de la frame " + to_string(frameNum) + " impossible";
+            if (!quiet) cerr << "\nErreur: écriture de la frame " << frameNum << " impossible\n";
+            return false;
+        }
         
         frameNum++;
-        if (frameNum % 30 == 0) {
+        if (!quiet && frameNum % 30 == 0) {
             cout << "Frame " << frameNum << "/" << frameCount 
-                 << " (" << (frameNum * 100 / frameCount) << "%)\r" << flush;
+                 << " (" << (frameNum * 100 / max(1, frameCount)) << "%)\r" << flush;
         }
     }
     
-    cout << "\nTraitement vidéo terminé!\n";
-    
     cap.release();
     writer.release();
     
-    // Intégrer l'audio avec ffmpeg
-    cout << "\nIntégration de l'audio...\n";
+    stats.frames = frameNum;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+// Fichiers à traiter : manifeste (une vidéo par ligne, sortie optionnelle après
+// une tabulation) ou dossier (toutes les vidéos qu'il contient).
+bool collectBatch(const Config& cfg, vector<pair<string, string>>& jobs) {
+    namespace fs = std::filesystem;
+    error_code ec;
+    fs::path outDir(cfg.batchOutDir);
+    auto defaultOutput = [&](const fs::path& in) { return (outDir / in.filename()).string(); };
+    
+    if (fs::is_directory(cfg.batch, ec)) {
+        const vector<string> exts = { ".mp4", ".mov", ".mkv", ".avi", ".webm", ".m4v" };
+        for (const auto& entry : fs::directory_iterator(cfg.batch, ec)) {
+            if (!entry.is_regular_file()) continue;
+            string ext = entry.path().extension().string();
+            transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (find(exts.begin(), exts.end(), ext) == exts.end()) continue;
+            jobs.emplace_back(entry.path().string(), defaultOutput(entry.path()));
+        }
+        sort(jobs.begin(), jobs.end());
+    } else {
+        ifstream manifest(cfg.batch);
+        if (!manifest.is_open()) {
+            cerr << "Erreur: Impossible de lire le batch: " << cfg.batch << endl;
+            return false;
+        }
+        string line;
+        while (getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            size_t tab = line.find('\t');
+            string input = line.substr(0, tab);
+            string output = tab != string::npos ? line.substr(tab + 1) : defaultOutput(input);
+            jobs.emplace_back(input, output);
+        }
+    }
+    
+    if (jobs.empty()) {
+        cerr << "Erreur: aucune vidéo dans le batch: " << cfg.batch << endl;
+        return false;
+    }
     
-    string tempVideo = cfg.outputVideo + "_temp.avi";
-    string cmdRename = "mv \"" + cfg.outputVideo + "\" \"" + tempVideo + "\"";
-    system(cmdRename.c_str());
+    // Chemins comparés sous forme canonique (./a.mp4 == a.mp4, liens résolus)
+    auto canonical = [&](const string& path) { return fs::weakly_canonical(fs::absolute(path, ec), ec).string(); };
+    set<string> inputs, outputs;
+    for (const auto& job : jobs) inputs.insert(canonical(job.first));
+    for (const auto& job : jobs) {
+        const string out = canonical(job.second);
+        if (inputs.count(out)) {
+            cerr << "Erreur: la sortie écraserait une entrée: " << job.second << endl;
+            return false;
+        }
+        if (!outputs.insert(out).second) {
+            cerr << "Erreur: plusieurs vidéos du batch écriraient " << job.second << endl;
+            return false;
+        }
+    }
     
-    string cmdFFmpeg = "ffmpeg -i \"" + tempVideo + "\" -i \"" + cfg.mainVideo + 
-                       "\" -c:v copy -map 0:v:0 -map 1:a:0? -shortest -y \"" + 
-                       cfg.outputVideo + "\" 2>/dev/null";
+    // Dossier de chaque sortie (--batch-out ou chemins explicites du manifeste)
+    fs::create_directories(outDir, ec);
+    for (const auto& job : jobs) {
+        fs::path parent = fs::path(job.second).parent_path();
+        if (!parent.empty()) fs::create_directories(parent, ec);
+    }
+    return true;
+}
+
+// Traite tous les fichiers du batch en parallèle sous un budget global de threads.
+//
+// Chaque fichier en cours occupe au moins trois threads : composition,
+// décodeur et encodeur. On lance donc au plus budget / 3 fichiers à la fois ;
+// le reste du budget est partagé à parts égales entre leurs décodeurs et
+// encodeurs, pour ne pas dépasser le nombre de coeurs demandé (sauf budget
+// inférieur à 3, où un fichier utilise tout de même ses trois threads).
+int runBatch(const Config& cfg, const sprite::SpriteSheet& sprites) {
+    vector<pair<string, string>> jobs;
+    if (!collectBatch(cfg, jobs)) return 1;
+    
+    const int budget = cfg.threads > 0 ? cfg.threads
+                                       : max(1, static_cast<int>(thread::hardware_concurrency()));
+    const int concurrent = max(1, min(budget / 3, static_cast<int>(jobs.size())));
+    const int perCodec = max(1, (budget - concurrent) / concurrent / 2);
+    cout << "\nBatch: " << jobs.size() << " vidéos, " << concurrent << " en parallèle, "
+         << perCodec << " thread(s) pour le décodeur et autant pour l'encodeur de chacune (budget "
+         << budget << ")\n\n";
+    
+    vector<JobStats> results(jobs.size());
+    atomic<size_t> next(0);
+    atomic<int> done(0);
+    mutex printMutex;
+    auto started = chrono::steady_clock::now();
+    
+    vector<thread> workers;
+    for (int w = 0; w < concurrent; w++) {
+        workers.emplace_back([&] {
+            for (size_t i = next++; i < jobs.size(); i = next++) {
+                JobStats& r = results[i];
+                bool ok = processVideo(cfg, jobs[i].first, jobs[i].second, sprites, perCodec, true, r);
+                lock_guard<mutex> lock(printMutex);
+                cout << "[" << ++done << "/" << jobs.size() << "] " << r.input;
+                if (ok) {
+                    cout << " -> " << r.output << ": " << r.frames << " frames en " << r.seconds << "s, "
+                         << r.fps() << " fps, " << r.megapixelsPerSecond() << " Mpx/s\n";
+                } else {
+                    cout << ": ✗ " << r.error << "\n";
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    long long frames = 0;
+    double megapixels = 0.0;
+    int failed = 0;
+    for (const JobStats& r : results) {
+        if (!r.error.empty()) {
+            failed++;
+            continue;
+        }
+        frames += r.frames;
+        megapixels += double(r.frames) * r.size.area() / 1e6;
+    }
+    cout << "\nTotal: " << (jobs.size() - failed) << "/" << jobs.size() << " vidéos, " << frames
+         << " frames en " << wall << "s, " << (wall > 0 ? frames / wall : 0.0) << " fps, "
+         << (wall > 0 ? megapixels / wall : 0.0) << " Mpx/s\n";
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
     
-    int result = system(cmdFFmpeg.c_str());
+    if (!parseArgs(argc, argv, cfg)) {
+        return 1;
+    }
     
-    if (result == 0) {
-        cout << "✓ Audio intégré avec succès!\n";
-        string cmdCleanup = "rm \"" + tempVideo + "\"";
-        system(cmdCleanup.c_str());
-        cout << "\n✓ Vidéo finale sauvegardée: " << cfg.outputVideo << endl;
-    } else {
-        cout << "⚠ Impossible d'intégrer l'audio (ffmpeg non disponible)\n";
-        cout << "  Vidéo sans audio: " << tempVideo << endl;
-        cout << "\n  Commande manuelle:\n";
-        cout << "  ffmpeg -i \"" << tempVideo << "\" -i \"" << cfg.mainVideo 
-             << "\" -c:v copy -map 0:v:0 -map 1:a:0 -shortest \"" 
-             << cfg.outputVideo << "\"\n";
+    cout << "=== Merge Image to Video ===\n\n";
+    
+    sprite::SpriteSheet sprites;
+    if (!prepareOverlay(cfg, sprites)) {
+        return 1;
+    }
+    
+    if (!cfg.batch.empty()) {
+        return runBatch(cfg, sprites);
     }
     
+    JobStats stats;
+    if (!processVideo(cfg, cfg.mainVideo, cfg.outputVideo, sprites, cfg.threads, false, stats)) {
+        return 1;
+    }
+    
+    cout << "\nTraitement vidéo terminé!\n";
+    cout << "\n✓ Vidéo finale sauvegardée: " << cfg.outputVideo << endl;
+    
     return 0;
 }
@@ -0,0 +1,224 @@
+#ifndef MOSAIC_H
+#define MOSAIC_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+#include "frame_pool.h"
+
+// Mode mosaïque (mur d'images) de video_merger : N vidéos composées sur une
+// grille en une seule passe, au lieu d'enchaîner N passes décodage/encodage.
+//
+// Un thread de décodage par entrée réduit chaque frame directement à la
+// taille de sa cellule (INTER_AREA) ; le thread de composition ne fait plus
+// que copier des cellules déjà prêtes dans la frame de sortie, et l'encodage
+// tourne dans son propre thread. Le débit suit le nombre de coeurs jusqu'à ce
+// que l'encodeur devienne le goulot d'étranglement.
+
+namespace mosaic {
+
+struct Grid {
+    int cols = 0;
+    int rows = 0;
+    int cells() const { return cols * rows; }
+};
+
+// "3x3", "4x2"... ; "auto" choisit la grille la plus carrée pour `count` entrées
+inline bool parseGrid(const std::string& text, int count, Grid& grid) {
+    if (text == "auto") {
+        grid.cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count)))));
+        grid.rows = std::max(1, (count + grid.cols - 1) / grid.cols);
+        return true;
+    }
+    int c = 0, r = 0;
+    char sep = 0;
+    std::stringstream ss(text);
+    if (!(ss >> c >> sep >> r) || (sep != 'x' && sep != 'X') || c <= 0 || r <= 0) return false;
+    grid.cols = c;
+    grid.rows = r;
+    return true;
+}
+
+// Rectangle de la cellule `i` (ordre de lecture) dans une sortie de taille `out`
+inline cv::Rect cellRect(const Grid& grid, cv::Size out, int i) {
+    int col = i % grid.cols, row = i / grid.cols;
+    int x0 = col * out.width / grid.cols, x1 = (col + 1) * out.width / grid.cols;
+    int y0 = row * out.height / grid.rows, y1 = (row + 1) * out.height / grid.rows;
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+// Plus grand rectangle au ratio de `src` centré dans `cell` (bandes noires)
+inline cv::Rect fitRect(cv::Size src, const cv::Rect& cell) {
+    if (src.width <= 0 || src.height <= 0) return cell;
+    double s = std::min(static_cast<double>(cell.width) / src.width,
+                        static_cast<double>(cell.height) / src.height);
+    int w = std::max(1, static_cast<int>(src.width * s));
+    int h = std::max(1, static_cast<int>(src.height * s));
+    return cv::Rect(cell.x + (cell.width - w) / 2, cell.y + (cell.height - h) / 2, w, h);
+}
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string output;
+    Grid grid;
+    cv::Size size;        // taille de sortie ; vide = taille de la première entrée
+    int maxQueuedFrames = 4;
+};
+
+// Une entrée de la mosaïque : décodeur, cellule et file vers la composition
+struct Input {
+    std::string path;
+    cv::VideoCapture cap;
+    cv::Rect rect;        // zone occupée dans la frame de sortie
+    std::unique_ptr<BoundedQueue<cv::Mat>> queue;
+    std::unique_ptr<framepool::FramePool> pool;
+    long long frames = 0;
+    bool done = false;    // plus de frame : la dernière reste affichée
+};
+
+inline int run(const Options& opt) {
+    using namespace std;
+
+    if (opt.inputs.empty() || opt.grid.cells() < static_cast<int>(opt.inputs.size())) {
+        cerr << "Erreur: La grille " << opt.grid.cols << "x" << opt.grid.rows
+             << " est trop petite pour " << opt.inputs.size() << " vidéos\n";
+        return 1;
+    }
+
+    vector<unique_ptr<Input>> inputs;
+    for (const string& path : opt.inputs) {
+        unique_ptr<Input> in(new Input());
+        in->path = path;
+        if (!in->cap.open(path)) {
+            cerr << "Erreur: Impossible d'ouvrir la vidéo: " << path << endl;
+            return 1;
+        }
+        inputs.push_back(std::move(in));
+    }
+
+    double fps = inputs[0]->cap.get(cv::CAP_PROP_FPS);
+    if (fps <= 0.0) fps = 25.0;
+    cv::Size outSize = opt.size;
+    if (outSize.area() == 0) {
+        outSize = cv::Size(static_cast<int>(inputs[0]->cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                           static_cast<int>(inputs[0]->cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    }
+
+    cout << "Mosaïque " << opt.grid.cols << "x" << opt.grid.rows << ": " << inputs.size()
+         << " vidéos -> " << outSize.width << "x" << outSize.height << " @ " << fps << " fps\n";
+
+    size_t queueSize = static_cast<size_t>(max(1, opt.maxQueuedFrames));
+    for (size_t i = 0; i < inputs.size(); i++) {
+        Input& in = *inputs[i];
+        cv::Size native(static_cast<int>(in.cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                        static_cast<int>(in.cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        in.rect = fitRect(native, cellRect(opt.grid, outSize, static_cast<int>(i)));
+        in.queue.reset(new BoundedQueue<cv::Mat>(queueSize));
+        // Frames en file + celle affichée + celle en cours de décodage
+        in.pool.reset(new framepool::FramePool(in.rect.size(), CV_8UC3, queueSize + 2));
+        cout << "  [" << i << "] " << in.path << ": " << native.width << "x" << native.height
+             << " -> cellule " << in.rect.width << "x" << in.rect.height << "\n";
+    }
+
+    cv::VideoWriter writer(opt.output, cv::VideoWriter::fourcc('M','J','P','G'), fps, outSize);
+    if (!writer.isOpened()) {
+        cerr << "Erreur: Impossible de créer la vidéo de sortie\n";
+        return 1;
+    }
+
+    // Un décodeur par entrée, réduction à la taille de la cellule dans le même thread
+    vector<thread> decoders;
+    for (auto& inPtr : inputs) {
+        Input* in = inPtr.get();
+        decoders.emplace_back([in] {
+            cv::Mat native;
+            while (true) {
+                const uchar* before = native.data;
+                if (!in->cap.read(native)) break;
+                framepool::trackBufferAllocation(before, native);
+
+                cv::Mat cell = in->pool->acquire();
+                if (native.size() == in->rect.size()) {
+                    native.copyTo(cell);
+                } else {
+                    cv::resize(native, cell, in->rect.size(), 0, 0, cv::INTER_AREA);
+                }
+                if (!in->queue->push(std::move(cell))) break;
+            }
+            in->queue->close();
+        });
+    }
+
+    // Encodage dans son propre thread, sur des frames de sortie recyclées
+    BoundedQueue<cv::Mat> writeQueue(queueSize);
+    framepool::FramePool outPool(outSize, CV_8UC3, queueSize + 2);
+    thread writerThread([&] {
+        cv::Mat frame;
+        while (writeQueue.pop(frame)) {
+            writer.write(frame);
+            outPool.release(std::move(frame));
+        }
+    });
+
+    // Composition : une frame de sortie par tick, tant qu'une entrée produit encore.
+    // Une entrée terminée garde sa dernière frame affichée.
+    vector<cv::Mat> shown(inputs.size());
+    auto start = chrono::steady_clock::now();
+    long long ticks = 0;
+    while (true) {
+        bool any = false;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            Input& in = *inputs[i];
+            if (in.done) continue;
+            cv::Mat cell;
+            if (!in.queue->pop(cell)) {
+                in.done = true;
+                continue;
+            }
+            if (!shown[i].empty()) in.pool->release(std::move(shown[i]));
+            shown[i] = std::move(cell);
+            in.frames++;
+            any = true;
+        }
+        if (!any) break;
+
+        cv::Mat frame = outPool.acquire();
+        frame.setTo(cv::Scalar::all(0));
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (!shown[i].empty()) shown[i].copyTo(frame(inputs[i]->rect));
+        }
+        if (!writeQueue.push(std::move(frame))) break;
+
+        ticks++;
+        if (ticks % 30 == 0) {
+            cout << "Frame " << ticks << "\r" << flush;
+        }
+    }
+
+    writeQueue.close();
+    writerThread.join();
+    for (auto& in : inputs) in->queue->close();
+    for (auto& d : decoders) d.join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "\nTraitement terminé! Vidéo sauvegardée: " << opt.output << endl;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        cout << "  [" << i << "] " << inputs[i]->frames << " frames\n";
+    }
+    cout << "Débit: " << (seconds > 0 ? ticks / seconds : 0.0) << " frames/s ("
+         << ticks << " frames en " << seconds << " s)" << endl;
+    return 0;
+}
+
+} // namespace mosaic
+
+#endif // MOSAIC_H
@@ -0,0 +1,183 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "transitionImageOpenCV/easing.h"
+
+// Trajectoires animées des overlays (glissements, zooms, dérive) définies par
+// des keyframes avec easing.
+//
+// Le déplacement sub-pixel est fait par une transformation affine précalculée
+// par frame et appliquée uniquement sur la boîte englobante de l'overlay dans
+// la frame principale (warpAffine avec une taille de sortie réduite), jamais
+// sur la frame entière. Si la transformation se réduit à une translation
+// entière, aucun warp n'est fait : l'overlay est copié directement.
+
+namespace motion {
+
+struct Keyframe {
+    double time = 0.0;   // secondes depuis le début de l'overlay
+    double x = 0.0;      // coin haut-gauche dans la frame principale
+    double y = 0.0;
+    double scale = 1.0;  // relatif à la taille de l'overlay (après --scale)
+    Easing::Type easing = Easing::Type::Linear;  // vers la keyframe suivante
+};
+
+// Placement de l'overlay sur une frame : translation + échelle
+struct Placement {
+    double x = 0.0;
+    double y = 0.0;
+    double scale = 1.0;
+    
+    // Vrai si le placement est une translation entière (pas de warp nécessaire)
+    bool integerTranslation(cv::Point& p) const {
+        const double eps = 1e-3;
+        if (std::abs(scale - 1.0) > eps) return false;
+        double rx = std::round(x), ry = std::round(y);
+        if (std::abs(x - rx) > eps || std::abs(y - ry) > eps) return false;
+        p = cv::Point(static_cast<int>(rx), static_cast<int>(ry));
+        return true;
+    }
+};
+
+class MotionPath {
+public:
+    void add(const Keyframe& k) {
+        auto it = std::upper_bound(keys_.begin(), keys_.end(), k.time,
+                                   [](double t, const Keyframe& e) { return t < e.time; });
+        keys_.insert(it, k);
+    }
+    
+    bool empty() const { return keys_.empty(); }
+    
+    // Placement à l'instant t ; maintenu sur la première / dernière keyframe hors de la plage
+    Placement at(double t) const {
+        Placement p;
+        if (keys_.empty()) return p;
+        if (t <= keys_.front().time) return place(keys_.front());
+        if (t >= keys_.back().time) return place(keys_.back());
+        
+        auto next = std::upper_bound(keys_.begin(), keys_.end(), t,
+                                     [](double v, const Keyframe& e) { return v < e.time; });
+        const Keyframe& b = *next;
+        const Keyframe& a = *(next - 1);
+        double span = b.time - a.time;
+        double u = span > 0 ? Easing::apply((t - a.time) / span, a.easing) : 1.0;
+        p.x = a.x + (b.x - a.x) * u;
+        p.y = a.y + (b.y - a.y) * u;
+        p.scale = a.scale + (b.scale - a.scale) * u;
+        return p;
+    }
+    
+    // Échelle maximale atteinte (bornée par les keyframes, les easings élastiques mis à part)
+    double maxScale() const {
+        double s = 1.0;
+        for (const Keyframe& k : keys_) s = std::max(s, k.scale);
+        return s;
+    }
+
+private:
+    static Placement place(const Keyframe& k) {
+        Placement p;
+        p.x = k.x;
+        p.y = k.y;
+        p.scale = k.scale;
+        return p;
+    }
+    
+    std::vector<Keyframe> keys_;
+};
+
+// Analyse "t:x,y[,scale[,easing]];..." (ex: "0:-320,40;1.5:40,40,1,ease-out")
+inline bool parsePath(const std::string& text, MotionPath& path) {
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        if (item.empty()) continue;
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) return false;
+        
+        Keyframe k;
+        std::vector<std::string> fields;
+        std::stringstream fs(item.substr(colon + 1));
+        std::string f;
+        while (std::getline(fs, f, ',')) fields.push_back(f);
+        if (fields.size() < 2) return false;
+        try {
+            k.time = std::stod(item.substr(0, colon));
+            k.x = std::stod(fields[0]);
+            k.y = std::stod(fields[1]);
+            if (fields.size() > 2) k.scale = std::stod(fields[2]);
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (fields.size() > 3 && !Easing::parse(fields[3], k.easing)) return false;
+        if (k.scale <= 0) return false;
+        path.add(k);
+    }
+    return !path.empty();
+}
+
+// Matrice affine source -> frame principale pour un placement
+inline cv::Matx23d affineFor(const Placement& p) {
+    return cv::Matx23d(p.scale, 0, p.x,
+                       0, p.scale, p.y);
+}
+
+// Boîte englobante entière de l'overlay transformé, intersectée avec la frame
+inline cv::Rect boundingBox(const Placement& p, cv::Size src, cv::Size canvas) {
+    int x0 = static_cast<int>(std::floor(p.x));
+    int y0 = static_cast<int>(std::floor(p.y));
+    int x1 = static_cast<int>(std::ceil(p.x + p.scale * src.width));
+    int y1 = static_cast<int>(std::ceil(p.y + p.scale * src.height));
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(cv::Point(0, 0), canvas);
+}
+
+// Applique le placement à l'image, limité à sa boîte englobante, dans une vue
+// (en haut à gauche) de `buf`, réutilisé d'une frame à l'autre. Avec
+// BORDER_CONSTANT, les pixels hors de l'overlay sont à 0 : une image BGRA
+// prémultipliée ou un masque y est donc transparent. Une couleur non
+// prémultipliée doit être étendue (BORDER_REPLICATE), sinon ses bords sub-pixel
+// tirent vers le noir avant d'être encore atténués par le masque.
+// Retourne false si l'overlay est hors de la frame.
+inline bool warpToBox(const cv::Mat& src, const Placement& p, cv::Size canvas, cv::Mat& buf,
+                      cv::Mat& image, cv::Point& origin, int borderMode = cv::BORDER_CONSTANT) {
+    cv::Rect box = boundingBox(p, src.size(), canvas);
+    if (box.empty()) return false;
+    
+    // Agrandit le buffer uniquement si la boîte dépasse sa taille actuelle
+    if (buf.cols < box.width || buf.rows < box.height || buf.type() != src.type()) {
+        buf.create(cv::Size(std::max(buf.cols, box.width), std::max(buf.rows, box.height)), src.type());
+    }
+    image = buf(cv::Rect(0, 0, box.width, box.height));
+    
+    cv::Matx23d m = affineFor(p);
+    m(0, 2) -= box.x;
+    m(1, 2) -= box.y;
+    cv::warpAffine(src, image, m, box.size(), cv::INTER_LINEAR, borderMode);
+    origin = box.tl();
+    return true;
+}
+
+// Variante avec masque : l'image (couleur non prémultipliée) est étendue au
+// bord, le masque transformé avec un bord transparent. Un masque
+// source vide est traité comme opaque : `opaque` (de la taille de la source,
+// rempli de 255) sert alors de couverture, pour que les bords sub-pixel soient
+// mélangés.
+inline bool warpToBox(const cv::Mat& src, const cv::Mat& srcMask, const cv::Mat& opaque,
+                      const Placement& p, cv::Size canvas, cv::Mat& imageBuf, cv::Mat& maskBuf,
+                      cv::Mat& image, cv::Mat& mask, cv::Point& origin) {
+    if (!warpToBox(src, p, canvas, imageBuf, image, origin, cv::BORDER_REPLICATE)) return false;
+    cv::Point maskOrigin;
+    return warpToBox(srcMask.empty() ? opaque : srcMask, p, canvas, maskBuf, mask, maskOrigin);
+}
+
+} // namespace motion
+
+#endif // MOTION_H
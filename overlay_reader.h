@@ -0,0 +1,196 @@
+#ifndef OVERLAY_READER_H
+#define OVERLAY_READER_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "alpha_capture.h"
+#include "composite.h"
+
+// Lecteur séquentiel pour la vidéo d'incrustation.
+//
+// La vidéo est ouverte une seule fois ; on se positionne au plus une fois sur
+// la première frame demandée, puis on décode en avançant. Un seek explicite
+// (CAP_PROP_POS_FRAMES) n'est effectué que lorsque la timeline saute
+// réellement : retour en arrière, ou saut en avant plus grand que maxSkip.
+// Pour les petits sauts en avant, on se contente de grab() sans décoder
+// l'image, ce qui reste bien moins cher qu'un seek vers la keyframe.
+//
+// readAt() adresse l'overlay par temps de présentation plutôt que par index,
+// pour les overlays dont le fps diffère de la vidéo principale : la dernière
+// frame décodée est conservée, ce qui permet de la répéter (overlay plus lent)
+// ou de sauter des frames (overlay plus rapide) sans jamais redécoder. Le coût
+// de décodage reste proportionnel au nombre de frames natives de l'overlay.
+//
+// Avec alpha = true, l'overlay est lu par AlphaCapture et les frames sont en
+// BGRA prémultiplié au lieu de BGR.
+//
+// setOutputSize() fait réduire chaque frame dès la lecture, dans le thread de
+// décodage, par INTER_AREA (une seule fois par frame native, y compris pour
+// les frames répétées ou mélangées par readAt) : l'étage de composition reçoit
+// des frames déjà à la taille finale de l'overlay.
+//
+// setRange() limite la lecture à un extrait [in, out) de l'overlay, sans
+// ré-encodage préalable : les index de read() / readAt() deviennent relatifs
+// au point d'entrée. Le premier accès fait un seul seek, vers la keyframe qui
+// précède le point d'entrée (connue par media_probe.h), puis décode en avant
+// jusqu'à lui ; la lecture reste ensuite séquentielle jusqu'au point de sortie.
+
+enum class ResampleMode {
+    NEAREST,  // frame affichée à l'instant t (répétition / saut)
+    BLEND     // mélange des deux frames qui encadrent t
+};
+
+class OverlayReader {
+public:
+    OverlayReader() = default;
+    explicit OverlayReader(const std::string& path, bool alpha = false) { open(path, alpha); }
+
+    bool open(const std::string& path, bool alpha = false) {
+        cap_.release();
+        alphaCap_.release();
+        alpha_ = alpha;
+        nextIndex_ = 0;
+        seekCount_ = 0;
+        curIndex_ = nxtIndex_ = -1;
+        inPoint_ = 0;
+        outPoint_ = -1;
+        inKeyframe_ = -1;
+        return alpha_ ? alphaCap_.open(path) : cap_.open(path);
+    }
+
+    bool isOpened() const { return alpha_ ? alphaCap_.isOpened() : cap_.isOpened(); }
+    double get(int propId) const { return alpha_ ? alphaCap_.get(propId) : cap_.get(propId); }
+    void release() {
+        cap_.release();
+        alphaCap_.release();
+    }
+
+    // Nombre de seeks réellement effectués depuis l'ouverture.
+    int seekCount() const { return seekCount_; }
+
+    // Taille des frames rendues ; vide = taille native.
+    void setOutputSize(cv::Size size) { outSize_ = size; }
+
+    // Au-delà de cet écart en avant, un seek coûte moins cher que des grab().
+    void setMaxSkip(int frames) { maxSkip_ = frames; }
+
+    // Extrait [in, out) en frames natives (out < 0 = jusqu'à la fin) ; `keyframe`
+    // est la keyframe qui précède `in`, -1 si inconnue (le backend la cherche alors lui-même).
+    void setRange(int in, int out, int keyframe = -1) {
+        inPoint_ = std::max(0, in);
+        outPoint_ = out;
+        inKeyframe_ = keyframe >= 0 && keyframe <= inPoint_ ? keyframe : -1;
+        curIndex_ = nxtIndex_ = -1;
+    }
+
+    // Lit la frame d'index `index` (0 = première frame de l'overlay, ou de l'extrait).
+    bool read(int index, cv::Mat& frame) {
+        if (index < 0 || !isOpened()) return false;
+        index += inPoint_;
+        if (outPoint_ >= 0 && index >= outPoint_) return false;
+
+        if (index != nextIndex_) {
+            int gap = index - nextIndex_;
+            if (gap > 0 && gap <= maxSkip_) {
+                if (!skipTo(index)) return false;
+            } else {
+                // Point d'entrée : seek sur sa keyframe, puis décodage en avant
+                int target = index == inPoint_ && inKeyframe_ >= 0 ? inKeyframe_ : index;
+                if (alpha_) {
+                    alphaCap_.set(cv::CAP_PROP_POS_FRAMES, target);
+                } else {
+                    cap_.set(cv::CAP_PROP_POS_FRAMES, target);
+                }
+                nextIndex_ = target;
+                seekCount_++;
+                if (!skipTo(index)) return false;
+            }
+        }
+
+        // Réduction à la lecture : décodage dans un buffer natif réutilisé
+        const bool scale = outSize_.area() > 0;
+        cv::Mat& decoded = scale ? native_ : frame;
+        if (!(alpha_ ? alphaCap_.read(decoded) : cap_.read(decoded))) return false;
+        nextIndex_++;
+
+        // Prémultiplier avant réduction : pas de franges aux bords transparents
+        if (alpha_) composite::premultiply(decoded);
+        if (scale) {
+            if (decoded.size() == outSize_) {
+                decoded.copyTo(frame);
+            } else {
+                cv::resize(decoded, frame, outSize_, 0, 0, cv::INTER_AREA);
+            }
+        }
+        return true;
+    }
+
+    // Frame native de l'overlay à l'instant t (secondes), pour un overlay à `fps`.
+    static int frameAt(double t, double fps) {
+        return static_cast<int>(std::floor(t * fps + 1e-6));
+    }
+
+    // Écrit dans `frame` l'image de l'overlay à l'instant t (secondes).
+    bool readAt(double t, double fps, cv::Mat& frame, ResampleMode mode = ResampleMode::NEAREST) {
+        if (t < 0 || fps <= 0) return false;
+        double pos = t * fps;
+        int k = frameAt(t, fps);
+        if (!cached(k, cur_, curIndex_)) return false;
+
+        double w = pos - k;
+        if (mode == ResampleMode::BLEND && w > 1e-3 && cached(k + 1, nxt_, nxtIndex_)) {
+            cv::addWeighted(cur_, 1.0 - w, nxt_, w, 0.0, frame);
+        } else {
+            cur_.copyTo(frame);
+        }
+        return true;
+    }
+
+private:
+    // Avance jusqu'à `index` par grab(), sans conversion des frames passées
+    bool skipTo(int index) {
+        while (nextIndex_ < index) {
+            if (!(alpha_ ? alphaCap_.grab() : cap_.grab())) return false;
+            nextIndex_++;
+        }
+        return true;
+    }
+
+    // Garantit que `slot` contient la frame `index`, en réutilisant le cache
+    // (frame courante / suivante) avant de décoder.
+    bool cached(int index, cv::Mat& slot, int& slotIndex) {
+        if (slotIndex == index) return true;
+        if (&slot == &cur_ && nxtIndex_ == index) {
+            std::swap(cur_, nxt_);
+            std::swap(curIndex_, nxtIndex_);
+            return true;
+        }
+        if (!read(index, slot)) {
+            slotIndex = -1;
+            return false;
+        }
+        slotIndex = index;
+        return true;
+    }
+
+    cv::VideoCapture cap_;
+    AlphaCapture alphaCap_;
+    bool alpha_ = false;
+    cv::Mat cur_, nxt_;  // frames décodées qui encadrent le dernier instant demandé
+    cv::Mat native_;     // frame native avant réduction (setOutputSize)
+    cv::Size outSize_;
+    int curIndex_ = -1;
+    int nxtIndex_ = -1;
+    int nextIndex_ = 0;  // index natif de la frame que read() décoderait sans seek
+    int inPoint_ = 0;    // extrait [inPoint_, outPoint_) en frames natives
+    int outPoint_ = -1;
+    int inKeyframe_ = -1;
+    int seekCount_ = 0;
+    int maxSkip_ = 8;
+};
+
+#endif // OVERLAY_READER_H
@@ -0,0 +1,310 @@
+#ifndef PIP_STYLE_H
+#define PIP_STYLE_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "composite.h"
+#include "frame_pool.h"
+
+// Habillage « incrustation broadcast » d'un overlay : coins arrondis, bordure
+// et ombre portée douce.
+//
+// Tout ce qui ne dépend que de la taille de l'overlay est calculé une seule
+// fois, dans build() :
+//   - coverage   : couverture des coins arrondis (CV_8UC1, anticrénelée par
+//                  distance signée au rectangle arrondi), vide si radius == 0 ;
+//   - decoration : ombre floutée (GaussianBlur) et bordure extérieure, en BGRA
+//                  prémultiplié sur une toile qui déborde de l'overlay.
+// Les deux sont aussi découpés en segments par ligne (pixels non transparents,
+// couverture pleine ou partielle).
+//
+// Par frame, il ne reste qu'à dessiner la décoration segment par segment, puis
+// l'overlay avec la couverture appliquée à la volée par le noyau (drawCovered),
+// sans flou, tracé ni copie intermédiaire. Pour un overlay opaque, la
+// décoration est mise à zéro sous l'overlay : ces pixels ne sont dans aucun
+// segment et chaque pixel de la boîte englobante n'est composé qu'une fois.
+// Seuls les placements sub-pixel (trajectoires) et les modes de fusion ou
+// l'opacité passent encore par une copie de l'overlay multipliée par les coins.
+
+namespace pip {
+
+struct Style {
+    int radius = 0;                                  // rayon des coins (px, taille finale de l'overlay)
+    int border = 0;                                  // épaisseur de la bordure extérieure (px)
+    cv::Vec3b borderColor = cv::Vec3b(255, 255, 255);
+    int shadow = 0;                                  // flou de l'ombre (px), 0 = pas d'ombre
+    cv::Point shadowOffset = cv::Point(6, 6);
+    double shadowOpacity = 0.5;
+
+    bool enabled() const { return radius > 0 || border > 0 || shadow > 0; }
+};
+
+namespace detail {
+
+// Distance signée au rectangle arrondi de centre (cx, cy), demi-côtés (hw, hh)
+inline float roundedRectDistance(float px, float py, float cx, float cy, float hw, float hh, float r) {
+    r = std::min(r, std::min(hw, hh));
+    float qx = std::abs(px - cx) - (hw - r);
+    float qy = std::abs(py - cy) - (hh - r);
+    float ox = std::max(qx, 0.f), oy = std::max(qy, 0.f);
+    return std::sqrt(ox * ox + oy * oy) + std::min(std::max(qx, qy), 0.f) - r;
+}
+
+// Couverture 0..1 du rectangle arrondi `rect` sur une toile CV_32F dont (0, 0) est en `origin`
+inline void renderRoundedRect(cv::Mat& dst, cv::Point origin, cv::Rect rect, float radius) {
+    const float cx = rect.x + rect.width * 0.5f, cy = rect.y + rect.height * 0.5f;
+    const float hw = rect.width * 0.5f, hh = rect.height * 0.5f;
+    for (int y = 0; y < dst.rows; y++) {
+        float* p = dst.ptr<float>(y);
+        const float py = origin.y + y + 0.5f;
+        for (int x = 0; x < dst.cols; x++) {
+            float d = roundedRectDistance(origin.x + x + 0.5f, py, cx, cy, hw, hh, radius);
+            p[x] = std::min(std::max(0.5f - d, 0.f), 1.f);
+        }
+    }
+}
+
+} // namespace detail
+
+// Segments non transparents de chaque ligne d'une image statique
+struct RunList {
+    struct Run {
+        int x0, x1;  // colonnes [x0, x1)
+        bool full;   // toutes les valeurs à 255
+    };
+    std::vector<Run> runs;
+    std::vector<int> rowRuns;  // segments de la ligne y : [rowRuns[y], rowRuns[y + 1])
+
+    // Canal `channel` de `m` ; splitFull : sépare les segments pleins des partiels
+    void build(const cv::Mat& m, int channel, bool splitFull) {
+        const int cn = m.channels();
+        runs.clear();
+        rowRuns.assign(1, 0);
+        for (int y = 0; y < m.rows; y++) {
+            const uchar* p = m.ptr<uchar>(y) + channel;
+            int x = 0;
+            while (x < m.cols) {
+                if (p[x * cn] == 0) {
+                    x++;
+                    continue;
+                }
+                const bool full = splitFull && p[x * cn] == 255;
+                int end = x + 1;
+                while (end < m.cols && p[end * cn] != 0 && (!splitFull || (p[end * cn] == 255) == full)) end++;
+                runs.push_back(Run{ x, end, full });
+                x = end;
+            }
+            rowRuns.push_back(static_cast<int>(runs.size()));
+        }
+    }
+
+    void clear() {
+        runs.clear();
+        rowRuns.clear();
+    }
+};
+
+class Masks {
+public:
+    bool empty() const { return decoration_.empty() && coverage_.empty(); }
+    const cv::Mat& coverage() const { return coverage_; }
+    const cv::Mat& decoration() const { return decoration_; }
+    const RunList& coverageRuns() const { return coverageRuns_; }
+    const RunList& decorationRuns() const { return decorationRuns_; }
+    // Position du coin de la décoration par rapport au coin de l'overlay
+    cv::Point decorationOffset() const { return offset_; }
+
+    // opaqueContent : l'overlay n'a ni masque ni alpha (la décoration sous lui est invisible)
+    void build(cv::Size size, const Style& s, bool opaqueContent) {
+        coverage_.release();
+        decoration_.release();
+        coverageRuns_.clear();
+        decorationRuns_.clear();
+        if (!s.enabled() || size.area() == 0) return;
+
+        const cv::Rect content(0, 0, size.width, size.height);
+        const float radius = static_cast<float>(std::max(0, s.radius));
+        cv::Mat inner(size, CV_32F);
+        detail::renderRoundedRect(inner, cv::Point(0, 0), content, radius);
+        if (s.radius > 0) {
+            inner.convertTo(coverage_, CV_8U, 255.0);
+            coverageRuns_.build(coverage_, 0, true);
+        }
+
+        if (s.border <= 0 && s.shadow <= 0) return;
+
+        // Toile : bordure + ombre décalée et son étalement par le flou
+        const int b = std::max(0, s.border);
+        const cv::Rect outer(-b, -b, size.width + 2 * b, size.height + 2 * b);
+        const float outerRadius = s.radius > 0 ? radius + b : 0.f;
+        cv::Rect canvas = outer;
+        cv::Rect shadowRect;
+        if (s.shadow > 0) {
+            shadowRect = outer + s.shadowOffset;
+            canvas |= cv::Rect(shadowRect.x - s.shadow, shadowRect.y - s.shadow,
+                               shadowRect.width + 2 * s.shadow, shadowRect.height + 2 * s.shadow);
+        }
+        offset_ = canvas.tl();
+
+        cv::Mat innerCanvas(canvas.size(), CV_32F), ring(canvas.size(), CV_32F, cv::Scalar(0));
+        detail::renderRoundedRect(innerCanvas, offset_, content, radius);
+        if (b > 0) {
+            detail::renderRoundedRect(ring, offset_, outer, outerRadius);
+            ring = cv::max(ring - innerCanvas, 0.0);
+        }
+        cv::Mat shade(canvas.size(), CV_32F, cv::Scalar(0));
+        if (s.shadow > 0) {
+            detail::renderRoundedRect(shade, offset_, shadowRect, outerRadius);
+            cv::GaussianBlur(shade, shade, cv::Size(2 * s.shadow + 1, 2 * s.shadow + 1), s.shadow / 2.0);
+            shade *= std::min(std::max(s.shadowOpacity, 0.0), 1.0);
+        }
+
+        // Bordure par-dessus l'ombre (noire) : couleur prémultipliée = bordure x anneau
+        decoration_.create(canvas.size(), CV_8UC4);
+        for (int y = 0; y < canvas.height; y++) {
+            const float* r = ring.ptr<float>(y);
+            const float* sh = shade.ptr<float>(y);
+            const float* in = innerCanvas.ptr<float>(y);
+            uchar* d = decoration_.ptr<uchar>(y);
+            for (int x = 0; x < canvas.width; x++, d += 4) {
+                float a = r[x] + sh[x] * (1.f - r[x]);
+                if (opaqueContent && in[x] >= 1.f) a = 0.f;  // caché par l'overlay
+                d[0] = cv::saturate_cast<uchar>(s.borderColor[0] * r[x]);
+                d[1] = cv::saturate_cast<uchar>(s.borderColor[1] * r[x]);
+                d[2] = cv::saturate_cast<uchar>(s.borderColor[2] * r[x]);
+                d[3] = cv::saturate_cast<uchar>(a * 255.f);
+                if (d[3] == 0) d[0] = d[1] = d[2] = 0;
+            }
+        }
+        decorationRuns_.build(decoration_, 3, false);
+    }
+
+private:
+    cv::Mat coverage_;
+    cv::Mat decoration_;
+    RunList coverageRuns_;
+    RunList decorationRuns_;
+    cv::Point offset_;
+};
+
+// Masque de l'overlay multiplié par la couverture des coins (binary : masque > 0 = opaque)
+inline void combineMask(const cv::Mat& mask, bool binary, const cv::Mat& coverage, cv::Mat& out) {
+    CV_Assert(mask.size() == coverage.size() && mask.type() == CV_8UC1);
+    framepool::ensure(out, mask.size(), CV_8UC1);
+    for (int y = 0; y < mask.rows; y++) {
+        const uchar* m = mask.ptr<uchar>(y);
+        const uchar* c = coverage.ptr<uchar>(y);
+        uchar* o = out.ptr<uchar>(y);
+        for (int x = 0; x < mask.cols; x++) {
+            o[x] = binary ? (m[x] ? c[x] : 0) : static_cast<uchar>(composite::div255(m[x] * c[x]));
+        }
+    }
+}
+
+// Overlay BGRA prémultiplié multiplié par la couverture des coins (les 4 canaux)
+inline void coverBGRA(const cv::Mat& bgra, const cv::Mat& coverage, cv::Mat& out) {
+    CV_Assert(bgra.size() == coverage.size() && bgra.type() == CV_8UC4);
+    framepool::ensure(out, bgra.size(), CV_8UC4);
+    for (int y = 0; y < bgra.rows; y++) {
+        const uchar* p = bgra.ptr<uchar>(y);
+        const uchar* c = coverage.ptr<uchar>(y);
+        uchar* o = out.ptr<uchar>(y);
+        for (int x = 0; x < bgra.cols; x++, p += 4, o += 4) {
+            const int a = c[x];
+            if (a == 255) {
+                std::memcpy(o, p, 4);
+            } else {
+                o[0] = static_cast<uchar>(composite::div255(p[0] * a));
+                o[1] = static_cast<uchar>(composite::div255(p[1] * a));
+                o[2] = static_cast<uchar>(composite::div255(p[2] * a));
+                o[3] = static_cast<uchar>(composite::div255(p[3] * a));
+            }
+        }
+    }
+}
+
+// Parcourt les segments de `runs` visibles quand l'image de taille `size` est
+// placée en `pos` : fn(ligne source, x0, x1, segment plein, pixel destination de x0)
+template <typename Fn>
+inline void forEachVisibleRun(cv::Mat& background, cv::Size size, const RunList& runs, cv::Point pos, Fn fn) {
+    cv::Rect dstRoi, srcRoi;
+    if (!composite::clipOverlay(background.size(), size, pos, dstRoi, srcRoi)) return;
+    const int left = srcRoi.x, right = srcRoi.x + srcRoi.width;
+    for (int y = 0; y < dstRoi.height; y++) {
+        const int sy = srcRoi.y + y;
+        uchar* row = background.ptr<uchar>(dstRoi.y + y);
+        for (int i = runs.rowRuns[sy]; i < runs.rowRuns[sy + 1]; i++) {
+            const RunList::Run& r = runs.runs[i];
+            const int x0 = std::max(r.x0, left), x1 = std::min(r.x1, right);
+            if (x0 < x1) fn(sy, x0, x1, r.full, row + (dstRoi.x + x0 - left) * 3);
+        }
+    }
+}
+
+// Décoration en position entière : seuls ses segments non transparents sont composés
+inline void drawDecoration(cv::Mat& background, const Masks& masks, cv::Point pos) {
+    const cv::Mat& deco = masks.decoration();
+    forEachVisibleRun(background, deco.size(), masks.decorationRuns(), pos,
+                      [&](int sy, int x0, int x1, bool, uchar* d) {
+        composite::premultipliedRow(d, deco.ptr<uchar>(sy) + x0 * 4, x1 - x0);
+    });
+}
+
+// Overlay en position entière, fusion normale, coins arrondis appliqués à la
+// volée : BGR + masque (vide = opaque, binary comme overlayROI) ou BGRA
+// prémultiplié. Les segments de couverture pleine passent par les noyaux
+// habituels, les coins partiels multiplient l'alpha pixel par pixel ; les
+// pixels hors des coins ne sont pas visités.
+inline void drawCovered(cv::Mat& background, const cv::Mat& image, const cv::Mat& mask, bool binary,
+                        const Masks& masks, cv::Point pos) {
+    CV_Assert(background.type() == CV_8UC3 && image.size() == masks.coverage().size());
+    CV_Assert(image.type() == CV_8UC4 || (image.type() == CV_8UC3 && (mask.empty() || mask.type() == CV_8UC1)));
+    const cv::Mat& coverage = masks.coverage();
+    if (image.type() == CV_8UC4) {
+        forEachVisibleRun(background, image.size(), masks.coverageRuns(), pos,
+                          [&](int sy, int x0, int x1, bool full, uchar* d) {
+            const uchar* f = image.ptr<uchar>(sy) + x0 * 4;
+            if (full) {
+                composite::premultipliedRow(d, f, x1 - x0);
+                return;
+            }
+            const uchar* c = coverage.ptr<uchar>(sy);
+            for (int x = x0; x < x1; x++, f += 4, d += 3) {
+                const int a = composite::div255(f[3] * c[x]);
+                if (a == 0) continue;
+                const uchar p[3] = { static_cast<uchar>(composite::div255(f[0] * c[x])),
+                                     static_cast<uchar>(composite::div255(f[1] * c[x])),
+                                     static_cast<uchar>(composite::div255(f[2] * c[x])) };
+                composite::blendPremultipliedPixel(p, d, a);
+            }
+        });
+        return;
+    }
+    forEachVisibleRun(background, image.size(), masks.coverageRuns(), pos,
+                      [&](int sy, int x0, int x1, bool full, uchar* d) {
+        const uchar* f = image.ptr<uchar>(sy) + x0 * 3;
+        const uchar* m = mask.empty() ? nullptr : mask.ptr<uchar>(sy) + x0;
+        if (full) {
+            composite::overlayRow(d, f, m, x1 - x0, binary);
+            return;
+        }
+        const uchar* c = coverage.ptr<uchar>(sy) + x0;
+        for (int x = 0; x < x1 - x0; x++) {
+            const int ma = !m ? 255 : binary ? (m[x] ? 255 : 0) : m[x];
+            const int a = composite::div255(ma * c[x]);
+            if (a == 255) {
+                std::memcpy(d + x * 3, f + x * 3, 3);
+            } else if (a > 0) {
+                composite::blendPixel(f + x * 3, d + x * 3, a);
+            }
+        }
+    });
+}
+
+} // namespace pip
+
+#endif // PIP_STYLE_H
@@ -0,0 +1,114 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Briques du pipeline décodage / composition / encodage de video_merger.
+
+// File FIFO bornée : push() bloque quand la file est pleine (contre-pression),
+// pop() bloque quand elle est vide. Après close(), push() échoue et pop()
+// vide ce qui reste puis retourne false.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_, notFull_;
+};
+
+// Remise en ordre des frames produites par les workers.
+// put() bloque tant que l'index est trop en avance sur le prochain index
+// attendu (fenêtre de `window` frames), ce qui borne la mémoire même si
+// l'encodeur est le goulot d'étranglement. La frame attendue n'est jamais
+// bloquée, donc le pipeline progresse toujours.
+template <typename T>
+class ReorderBuffer {
+public:
+    explicit ReorderBuffer(int window) : window_(window > 0 ? window : 1) {}
+
+    void put(int index, T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        canPut_.wait(lock, [&] { return closed_ || index < next_ + window_; });
+        if (closed_) return;
+        items_.emplace(index, std::move(item));
+        if (index == next_) ready_.notify_one();
+    }
+
+    // Récupère la frame suivante dans l'ordre ; false quand tout est consommé.
+    bool take(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] {
+            return (!items_.empty() && items_.begin()->first == next_) || finished_;
+        });
+        auto it = items_.find(next_);
+        if (it == items_.end()) return false;
+        item = std::move(it->second);
+        items_.erase(it);
+        next_++;
+        canPut_.notify_all();
+        return true;
+    }
+
+    // Plus aucune frame ne sera produite (tous les workers ont terminé).
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        ready_.notify_all();
+    }
+
+    // Arrêt d'urgence (ex. erreur d'écriture) : débloque les producteurs.
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        finished_ = true;
+        items_.clear();
+        canPut_.notify_all();
+        ready_.notify_all();
+    }
+
+private:
+    int window_;
+    int next_ = 0;
+    std::map<int, T> items_;
+    bool finished_ = false;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable ready_, canPut_;
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,178 @@
+#ifndef RENDITION_H
+#define RENDITION_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+#include "frame_pool.h"
+
+// Sorties multiples (2160p, 1080p, 720p...) à partir d'une seule composition.
+//
+// Chaque frame composée est partagée en lecture seule (shared_ptr<const Mat>)
+// entre toutes les sorties : chacune a son thread, qui réduit la frame à sa
+// taille (INTER_AREA, dans un buffer réutilisé) puis l'encode. La composition
+// n'est donc faite qu'une fois ; le coût d'une sortie supplémentaire se limite
+// à sa réduction et à son encodage, en parallèle des autres. La frame revient
+// à sa réserve quand la dernière sortie l'a relâchée.
+
+namespace rendition {
+
+struct Spec {
+    std::string path;
+    cv::Size size;                // (0, 0) = taille de la composition ; une dimension à 0 suit le ratio
+    std::string codec = "MJPG";   // fourcc
+};
+
+inline bool parseSize(const std::string& text, cv::Size& size) {
+    int w = -1, h = -1;
+    char extra = 0;
+    if (std::sscanf(text.c_str(), "%dx%d%c", &w, &h, &extra) != 2 || w < 0 || h < 0 || (w == 0 && h == 0)) {
+        return false;
+    }
+    size = cv::Size(w, h);
+    return true;
+}
+
+// "fichier[:LxH[:fourcc]]", lu depuis la fin (le chemin peut contenir ':')
+inline bool parseSpec(const std::string& text, Spec& spec) {
+    spec = Spec();
+    std::string rest = text;
+    size_t colon = rest.rfind(':');
+    if (colon != std::string::npos && !parseSize(rest.substr(colon + 1), spec.size)
+        && rest.size() - colon - 1 == 4) {
+        spec.codec = rest.substr(colon + 1);
+        rest.resize(colon);
+        colon = rest.rfind(':');
+    }
+    if (colon != std::string::npos && parseSize(rest.substr(colon + 1), spec.size)) {
+        rest.resize(colon);
+    }
+    spec.path = rest;
+    return !spec.path.empty();
+}
+
+// Taille effective d'une sortie pour une composition de taille `src` (dimensions paires)
+inline cv::Size resolveSize(cv::Size wanted, cv::Size src) {
+    if (wanted.width <= 0 && wanted.height <= 0) return src;
+    cv::Size s = wanted;
+    if (s.width <= 0) s.width = static_cast<int>(std::lround(double(src.width) * s.height / src.height));
+    if (s.height <= 0) s.height = static_cast<int>(std::lround(double(src.height) * s.width / src.width));
+    s.width = std::max(2, s.width & ~1);
+    s.height = std::max(2, s.height & ~1);
+    return s;
+}
+
+typedef std::shared_ptr<const cv::Mat> SharedFrame;
+
+class Fanout {
+public:
+    Fanout() = default;
+    Fanout(const Fanout&) = delete;
+    Fanout& operator=(const Fanout&) = delete;
+    ~Fanout() { finish(); }
+
+    // Ouvre un encodeur par sortie et démarre leurs threads.
+    bool open(const std::vector<Spec>& specs, double fps, cv::Size src, size_t queueSize) {
+        for (const Spec& spec : specs) {
+            std::unique_ptr<Output> out(new Output(queueSize));
+            out->spec = spec;
+            out->size = resolveSize(spec.size, src);
+            const std::string& c = spec.codec;
+            out->writer.open(spec.path, cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]), fps, out->size);
+            if (!out->writer.isOpened()) {
+                std::cerr << "Erreur: Impossible de créer la vidéo de sortie: " << spec.path
+                          << " (" << c << ")\n";
+                outputs_.clear();
+                return false;
+            }
+            outputs_.push_back(std::move(out));
+        }
+        for (auto& out : outputs_) {
+            Output* o = out.get();
+            o->thread = std::thread([o] { encode(*o); });
+        }
+        return true;
+    }
+
+    // Transmet la frame à toutes les sorties ; bloque si la plus lente est en retard.
+    void push(const SharedFrame& frame) {
+        for (auto& out : outputs_) out->queue.push(frame);
+    }
+
+    // Vide les files, attend les encodeurs et ferme les fichiers.
+    void finish() {
+        for (auto& out : outputs_) out->queue.close();
+        for (auto& out : outputs_) {
+            if (out->thread.joinable()) out->thread.join();
+            out->writer.release();
+        }
+    }
+
+    size_t size() const { return outputs_.size(); }
+
+    void report(std::ostream& os) const {
+        for (size_t i = 0; i < outputs_.size(); i++) {
+            const Output& o = *outputs_[i];
+            double n = o.frames ? double(o.frames) : 1.0;
+            os << "Sortie " << (i + 1) << ": " << o.spec.path << " " << o.size.width << "x" << o.size.height
+               << " " << o.spec.codec << ", " << o.frames << " frames, réduction "
+               << (o.resizeNs / 1e6 / n) << " ms/frame, encodage " << (o.encodeNs / 1e6 / n)
+               << " ms/frame\n";
+        }
+    }
+
+private:
+    struct Output {
+        explicit Output(size_t queueSize) : queue(queueSize) {}
+        Spec spec;
+        cv::Size size;
+        cv::VideoWriter writer;
+        BoundedQueue<SharedFrame> queue;
+        std::thread thread;
+        cv::Mat scaled;
+        long long frames = 0;
+        long long resizeNs = 0;
+        long long encodeNs = 0;
+    };
+
+    static long long elapsedNs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - since).count();
+    }
+
+    static void encode(Output& o) {
+        SharedFrame frame;
+        while (o.queue.pop(frame)) {
+            auto start = std::chrono::steady_clock::now();
+            const cv::Mat* out = frame.get();
+            if (frame->size() != o.size) {
+                framepool::ensure(o.scaled, o.size, frame->type());
+                const uchar* before = o.scaled.data;
+                cv::resize(*frame, o.scaled, o.size, 0, 0, cv::INTER_AREA);
+                framepool::trackBufferAllocation(before, o.scaled);
+                out = &o.scaled;
+                o.resizeNs += elapsedNs(start);
+                start = std::chrono::steady_clock::now();
+            }
+            o.writer.write(*out);
+            o.encodeNs += elapsedNs(start);
+            o.frames++;
+            frame.reset();  // rend la frame à sa réserve si c'était la dernière sortie
+        }
+    }
+
+    std::vector<std::unique_ptr<Output>> outputs_;
+};
+
+} // namespace rendition
+
+#endif // RENDITION_H
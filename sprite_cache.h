@@ -0,0 +1,341 @@
+#ifndef SPRITE_CACHE_H
+#define SPRITE_CACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "alpha_capture.h"
+#include "composite.h"
+
+// Overlays animés (GIF, APNG, WebP animé, séquences PNG "logo_%04d.png")
+// pré-décodés en sprites prémultipliés.
+//
+// Toutes les frames sont décodées une seule fois au chargement et préparées
+// par l'appelant (alpha, échelle, chroma key, opacité) en PremultipliedOverlay.
+// Par frame vidéo, il ne reste qu'une recherche dichotomique dans l'index
+// temporel (en boucle) : le coût est celui du filigrane fixe.
+//
+// Mémoire :
+//   - les frames sont décodées et préparées au fil de l'eau (par lots bornés
+//     pour cv::imreadanimation), jamais toute l'animation brute à la fois ;
+//   - les frames identiques consécutives (fréquentes dans les GIF) partagent
+//     le même sprite ;
+//   - dès que les sprites dépasseraient le budget, `step` double : une frame
+//     sur `step` est gardée et affichée pendant la durée des frames sautées
+//     (cadence réduite plutôt qu'un décodage par frame), les sprites déjà
+//     préparés hors de cette grille sont libérés.
+//
+// Sources :
+//   - séquence d'images ('%' dans le chemin) via AlphaCapture ;
+//   - fichiers (GIF, APNG, WebP) via le décodeur libav d'AlphaCapture si
+//     HAVE_LIBAV (un seul passage, durées d'après les timestamps, nombre de
+//     boucles relu dans l'en-tête), sinon via cv::imreadanimation
+//     (OpenCV >= 4.11) avec la durée de chaque frame et le nombre de boucles.
+// Les PNG et WebP ne sont tentés comme animation que si leur en-tête le dit
+// (chunk acTL, drapeau d'animation VP8X) : un logo fixe part directement
+// sur imread.
+// Une fois chargé, le SpriteSheet n'est plus modifié : il peut être partagé
+// en lecture seule entre threads.
+
+namespace sprite {
+
+// Prépare une frame décodée (BGR ou BGRA) en sprite
+typedef std::function<void(const cv::Mat& image, composite::PremultipliedOverlay& out)> PrepareFn;
+
+namespace detail {
+
+inline uint32_t readBE32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+inline uint32_t readLE32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// APNG : chunk acTL avant le premier IDAT
+inline bool isAnimatedPng(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    unsigned char sig[8];
+    if (!f.read(reinterpret_cast<char*>(sig), 8) || std::memcmp(sig, "\x89PNG\r\n\x1a\n", 8) != 0) return false;
+    unsigned char head[8];
+    while (f.read(reinterpret_cast<char*>(head), 8)) {
+        if (std::memcmp(head + 4, "acTL", 4) == 0) return true;
+        if (std::memcmp(head + 4, "IDAT", 4) == 0 || std::memcmp(head + 4, "IEND", 4) == 0) return false;
+        f.seekg(static_cast<std::streamoff>(readBE32(head)) + 4, std::ios::cur);  // données + CRC
+    }
+    return false;
+}
+
+// WebP animé : chunk VP8X avec le drapeau d'animation
+inline bool isAnimatedWebp(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    unsigned char head[21];
+    if (!f.read(reinterpret_cast<char*>(head), sizeof(head))) return false;
+    return std::memcmp(head, "RIFF", 4) == 0 && std::memcmp(head + 8, "WEBPVP8X", 8) == 0
+        && readLE32(head + 16) >= 10 && (head[20] & 0x02) != 0;
+}
+
+// Nombre de boucles écrit dans le fichier (0 = infinie, comme cv::Animation::loop_count).
+// Les démuxeurs libav n'exposent pas cette valeur : elle est relue dans l'en-tête.
+inline int loopCount(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    unsigned char head[16];
+    if (!f.read(reinterpret_cast<char*>(head), 13)) return 0;
+
+    // GIF : extension d'application NETSCAPE2.0 avant la première image
+    if (std::memcmp(head, "GIF8", 4) == 0) {
+        if (head[10] & 0x80) f.seekg(3 << ((head[10] & 0x07) + 1), std::ios::cur);  // palette globale
+        int c;
+        while ((c = f.get()) == 0x21) {
+            const int label = f.get();
+            int size = f.get();
+            bool netscape = false;
+            if (label == 0xFF && size == 11 && f.read(reinterpret_cast<char*>(head), 11))
+                netscape = std::memcmp(head, "NETSCAPE2.0", 11) == 0 || std::memcmp(head, "ANIMEXTS1.0", 11) == 0;
+            else if (size > 0) f.seekg(size, std::ios::cur);
+            while (f && (size = f.get()) > 0) {
+                if (netscape && size == 3 && f.read(reinterpret_cast<char*>(head), 3) && head[0] == 1)
+                    return head[1] | (head[2] << 8);
+                if (!netscape || size != 3) f.seekg(size, std::ios::cur);
+            }
+        }
+        return 0;
+    }
+
+    // APNG : acTL = nombre de frames puis nombre de lectures
+    if (std::memcmp(head, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        f.seekg(8);
+        while (f.read(reinterpret_cast<char*>(head), 8)) {
+            if (std::memcmp(head + 4, "acTL", 4) == 0)
+                return f.read(reinterpret_cast<char*>(head), 8) ? static_cast<int>(readBE32(head + 4)) : 0;
+            if (std::memcmp(head + 4, "IDAT", 4) == 0) return 0;
+            f.seekg(static_cast<std::streamoff>(readBE32(head)) + 4, std::ios::cur);
+        }
+        return 0;
+    }
+
+    // WebP : chunk ANIM = couleur de fond puis nombre de boucles (16 bits)
+    if (std::memcmp(head, "RIFF", 4) == 0) {
+        f.seekg(12);
+        while (f.read(reinterpret_cast<char*>(head), 8)) {
+            const uint32_t size = readLE32(head + 4);
+            if (std::memcmp(head, "ANIM", 4) == 0)
+                return f.read(reinterpret_cast<char*>(head), 6) ? head[4] | (head[5] << 8) : 0;
+            if (std::memcmp(head, "ANMF", 4) == 0) return 0;
+            f.seekg(static_cast<std::streamoff>(size + (size & 1)), std::ios::cur);
+        }
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// Chemins contenant (probablement) une animation ; les PNG / WebP fixes sont écartés sur leur en-tête.
+inline bool isAnimationPath(const std::string& path) {
+    if (path.find('%') != std::string::npos) return true;
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext == "png" || ext == "apng") return detail::isAnimatedPng(path);
+    if (ext == "webp") return detail::isAnimatedWebp(path);
+    return ext == "gif";
+}
+
+inline size_t spriteBytes(const composite::PremultipliedOverlay& s) {
+    return s.color.total() * s.color.elemSize() + s.invAlpha.total() * s.invAlpha.elemSize()
+         + s.runs.size() * sizeof(composite::PremultipliedOverlay::Run) + s.rowRuns.size() * sizeof(int);
+}
+
+class SpriteSheet {
+public:
+    // Sprite unique (image fixe)
+    void setStatic(composite::PremultipliedOverlay&& overlay) {
+        clear();
+        bytes_ = spriteBytes(overlay);
+        sprites_.push_back(std::move(overlay));
+        entries_.push_back(Entry{ 0.0, 0, 0 });
+        sourceFrames_ = 1;
+    }
+
+    // Décode toutes les frames de `path` et les prépare ; false si ce n'est pas
+    // une animation lisible (l'appelant retombe sur l'image fixe).
+    // fps : cadence des séquences et des fichiers sans durées (0 = 25 fps), ou
+    // cadence imposée si `forceFps`.
+    bool load(const std::string& path, double fps, bool forceFps, size_t maxBytes, const PrepareFn& prepare) {
+        clear();
+        maxBytes_ = maxBytes;
+        const double defaultDuration = 1.0 / (fps > 0 ? fps : 25.0);
+
+        // libav décode en un seul passage ; sans lui, lots de cv::imreadanimation
+#if !defined(HAVE_LIBAV) && CV_VERSION_MAJOR * 100 + CV_VERSION_MINOR >= 411
+        if (path.find('%') == std::string::npos) {
+            // imreadanimation redécode depuis le début pour atteindre `start` : lots aussi grands
+            // que possible (un quart du budget en frames brutes), la première frame mesure la taille
+            int start = 0, count = 1;
+            cv::Animation anim;
+            while (cv::imreadanimation(path, anim, start, count) && !anim.frames.empty()) {
+                if (start == 0) loops_ = anim.loop_count;
+                for (size_t i = 0; i < anim.frames.size(); i++) {
+                    double d = !forceFps && i < anim.durations.size() && anim.durations[i] > 0
+                             ? anim.durations[i] / 1000.0 : defaultDuration;
+                    add(anim.frames[i], d, prepare);
+                }
+                if (static_cast<int>(anim.frames.size()) < count) break;
+                const cv::Mat& f = anim.frames[0];
+                const size_t raw = std::max<size_t>(1, f.total() * f.elemSize());
+                start += count;
+                count = static_cast<int>(std::min<size_t>(256, std::max<size_t>(8, maxBytes / 4 / raw)));
+                anim = cv::Animation();
+            }
+            // Une seule frame : image fixe, laissée à imread
+            return sourceFrames_ > 1 && finish();
+        }
+#endif
+
+        // Séquence d'images, ou décodeur libav : frame par frame, durée d'après les timestamps
+        AlphaCapture cap;
+        if (!cap.open(path, true)) return false;
+        const double rate = cap.get(cv::CAP_PROP_FPS);
+        const double fixed = !forceFps && rate > 0 ? 1.0 / rate : defaultDuration;
+        cv::Mat frame, next;
+        // Une seule frame : image fixe, rien n'est préparé ici
+        if (!cap.read(frame)) return false;
+        double t = cap.get(cv::CAP_PROP_POS_MSEC);
+        if (!cap.read(next)) return false;
+        double d = fixed;
+        do {
+            const double tNext = cap.get(cv::CAP_PROP_POS_MSEC);
+            d = !forceFps && tNext > t ? (tNext - t) / 1000.0 : fixed;
+            add(frame, d, prepare);
+            cv::swap(frame, next);
+            t = tNext;
+        } while (cap.read(next));
+        add(frame, d, prepare);  // dernière frame : durée de la précédente
+        // Séquence : boucle infinie ; fichier : nombre de boucles de l'en-tête, comme imreadanimation
+        if (path.find('%') == std::string::npos) loops_ = detail::loopCount(path);
+        return finish();
+    }
+
+    // Sprite à afficher `seconds` après l'apparition de l'overlay
+    const composite::PremultipliedOverlay& at(double seconds) const {
+        if (entries_.size() == 1) return sprites_[entries_[0].sprite];
+        if (loops_ > 0 && seconds >= loops_ * duration_) return sprites_[entries_.back().sprite];
+        double t = std::fmod(std::max(seconds, 0.0), duration_);
+        auto it = std::upper_bound(entries_.begin(), entries_.end(), t,
+                                   [](double v, const Entry& e) { return v < e.start; });
+        return sprites_[(it - 1)->sprite];
+    }
+
+    const composite::PremultipliedOverlay& first() const { return sprites_.front(); }
+    bool empty() const { return sprites_.empty(); }
+    bool animated() const { return entries_.size() > 1; }
+    size_t sourceFrames() const { return sourceFrames_; }
+    size_t keptFrames() const { return entries_.size(); }
+    size_t sprites() const { return sprites_.size(); }
+    size_t bytes() const { return bytes_; }
+    int step() const { return static_cast<int>(step_); }
+    int loops() const { return loops_; }             // 0 = boucle infinie
+    double duration() const { return duration_; }    // durée d'une boucle (s)
+
+private:
+    struct Entry {
+        double start;  // début dans la boucle (s)
+        int sprite;
+        size_t source; // index de la frame dans le fichier
+    };
+
+    void clear() {
+        sprites_.clear();
+        entries_.clear();
+        last_.release();
+        firstSize_ = cv::Size();
+        bytes_ = 0;
+        sourceFrames_ = 0;
+        step_ = 1;
+        maxBytes_ = 0;
+        loops_ = 0;
+        duration_ = 0.0;
+    }
+
+    void add(const cv::Mat& source, double duration, const PrepareFn& prepare) {
+        const size_t index = sourceFrames_++;
+        const double start = duration_;
+        duration_ += duration;
+        if (index % step_ != 0) return;  // frame sautée : la précédente reste affichée
+
+        // Toutes les frames à la taille de la première (position calculée une fois)
+        cv::Mat frame = source;
+        if (firstSize_.area() == 0) firstSize_ = source.size();
+        if (source.size() != firstSize_) cv::resize(source, frame, firstSize_, 0, 0, cv::INTER_AREA);
+
+        // Frame identique à la précédente gardée : même sprite
+        const bool same = !last_.empty() && last_.type() == frame.type()
+                          && cv::norm(last_, frame, cv::NORM_INF) == 0;
+        if (same) {
+            entries_.push_back(Entry{ start, entries_.back().sprite, index });
+            return;
+        }
+
+        composite::PremultipliedOverlay s;
+        prepare(frame, s);
+        const size_t cost = spriteBytes(s);
+        // Budget dépassé : cadence divisée par deux jusqu'à ce que le nouveau sprite tienne
+        while (maxBytes_ > 0 && !sprites_.empty() && bytes_ + cost > maxBytes_) {
+            step_ *= 2;
+            decimate();
+            if (index % step_ != 0) return;
+        }
+        bytes_ += cost;
+        sprites_.push_back(std::move(s));
+        frame.copyTo(last_);
+        entries_.push_back(Entry{ start, static_cast<int>(sprites_.size()) - 1, index });
+    }
+
+    // Ne garde que les entrées sur la grille de `step_` et libère les sprites qui ne servent plus.
+    void decimate() {
+        std::vector<Entry> kept;
+        std::vector<int> remap(sprites_.size(), -1);
+        std::vector<composite::PremultipliedOverlay> used;
+        bytes_ = 0;
+        for (const Entry& e : entries_) {
+            if (e.source % step_ != 0) continue;
+            if (remap[e.sprite] < 0) {
+                remap[e.sprite] = static_cast<int>(used.size());
+                bytes_ += spriteBytes(sprites_[e.sprite]);
+                used.push_back(std::move(sprites_[e.sprite]));
+            }
+            kept.push_back(Entry{ e.start, remap[e.sprite], e.source });
+        }
+        entries_.swap(kept);
+        sprites_.swap(used);
+        last_.release();  // la dernière frame gardée a pu changer : pas de partage avec la suivante
+    }
+
+    bool finish() {
+        last_.release();
+        return !sprites_.empty() && duration_ > 0.0;
+    }
+
+    std::vector<composite::PremultipliedOverlay> sprites_;
+    std::vector<Entry> entries_;
+    cv::Mat last_;
+    cv::Size firstSize_;
+    size_t bytes_ = 0;
+    size_t sourceFrames_ = 0;
+    size_t step_ = 1;
+    size_t maxBytes_ = 0;
+    int loops_ = 0;
+    double duration_ = 0.0;
+};
+
+} // namespace sprite
+
+#endif // SPRITE_CACHE_H
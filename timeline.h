@@ -0,0 +1,80 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <algorithm>
+#include <vector>
+
+// Index d'intervalles [begin, end) en frames, pour savoir quels overlays sont
+// actifs sur une frame de la vidéo principale.
+//
+// Les requêtes se font par frames croissantes (balayage) : chaque intervalle
+// entre et sort de l'ensemble actif une seule fois, le coût total est donc
+// O(N log N + nombre de frames). Une requête en arrière relance le balayage.
+class IntervalIndex {
+public:
+    void add(int id, int begin, int end, int order) {
+        if (end <= begin) return;
+        entries_.push_back(Entry{ id, begin, end, order });
+        built_ = false;
+    }
+
+    // Identifiants actifs sur `frame`, triés par ordre de composition (z-order).
+    const std::vector<int>& activeAt(int frame) {
+        if (!built_ || frame < lastFrame_) rewind();
+        lastFrame_ = frame;
+
+        bool changed = false;
+        while (next_ < entries_.size() && entries_[next_].begin <= frame) {
+            if (entries_[next_].end > frame) active_.push_back(entries_[next_]);
+            next_++;
+            changed = true;
+        }
+        auto ended = std::remove_if(active_.begin(), active_.end(),
+                                    [frame](const Entry& e) { return e.end <= frame; });
+        if (ended != active_.end()) {
+            active_.erase(ended, active_.end());
+            changed = true;
+        }
+
+        if (changed) {
+            std::sort(active_.begin(), active_.end(), [](const Entry& a, const Entry& b) {
+                return a.order != b.order ? a.order < b.order : a.id < b.id;
+            });
+            ids_.clear();
+            for (const Entry& e : active_) ids_.push_back(e.id);
+        }
+        return ids_;
+    }
+
+    // Dernière frame couverte par un intervalle (exclue), 0 si vide.
+    int end() const {
+        int e = 0;
+        for (const Entry& entry : entries_) e = std::max(e, entry.end);
+        return e;
+    }
+
+private:
+    struct Entry { int id, begin, end, order; };
+
+    void rewind() {
+        if (!built_) {
+            std::stable_sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+                return a.begin < b.begin;
+            });
+            built_ = true;
+        }
+        next_ = 0;
+        lastFrame_ = 0;
+        active_.clear();
+        ids_.clear();
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<Entry> active_;
+    std::vector<int> ids_;
+    size_t next_ = 0;
+    int lastFrame_ = 0;
+    bool built_ = false;
+};
+
+#endif // TIMELINE_H
@@ -0,0 +1,73 @@
+#ifndef EASING_H
+#define EASING_H
+
+// Easing curves shared by the transitions and by video_merger motion paths.
+// Header-only and free of OpenCV / JSON dependencies so the root tools can
+// include it directly.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#ifndef PI
+#define PI 3.1415926545
+#endif
+
+// -------------------- Utility: Easing --------------------
+namespace Easing {
+    enum class Type { Linear, EaseIn, EaseOut, EaseInOut, EaseInBounce,
+                      EaseOutBounce, EaseInElastic, EaseOutElastic,
+                      EaseInCirc, EaseOutCirc, EaseInOutCirc,
+                      EaseInQuint, EaseOutQuint, EaseInOutQuint
+    };
+
+    // Curve name -> Type; false (out untouched) when the name is unknown
+    inline bool parse(const std::string& sIn, Type& out) {
+        std::string s = sIn;
+        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+        if (s == "linear") { out = Type::Linear; return true; }
+        if (s == "ease-in" || s == "easein") { out = Type::EaseIn; return true; }
+        if (s == "ease-out" || s == "easeout") { out = Type::EaseOut; return true; }
+        if (s == "ease-in-out" || s == "easeinout") { out = Type::EaseInOut; return true; }
+        if (s == "ease-in-bounce" || s == "easeinbounce") { out = Type::EaseInBounce; return true; }
+        if (s == "ease-out-bounce" || s == "easeoutbounce") { out = Type::EaseOutBounce; return true; }
+        if (s == "ease-in-elastic" || s == "easeinelastic") { out = Type::EaseInElastic; return true; }
+        if (s == "ease-out-elastic" || s == "easeoutelastic") { out = Type::EaseOutElastic; return true; }
+        if (s == "ease-in-circ" || s == "easeincirc") { out = Type::EaseInCirc; return true; }
+        if (s == "ease-out-circ" || s == "easeoutcirc") { out = Type::EaseOutCirc; return true; }
+        if (s == "ease-inout-circ" || s == "easeinoutcirc") { out = Type::EaseInOutCirc; return true; }
+        if (s == "ease-in-quint" || s == "easeinquint") { out = Type::EaseInQuint; return true; }
+        if (s == "ease-out-quint" || s == "easeoutquint") { out = Type::EaseOutQuint; return true; }
+        if (s == "ease-inout-quint" || s == "easeinoutquint") { out = Type::EaseInOutQuint; return true; }
+        return false;
+    }
+
+    inline double apply(double t, Type type) {
+        t = std::clamp(t, 0.0, 1.0);
+        switch(type) {
+            case Type::EaseIn:    return t*t*t;
+            case Type::EaseOut:   { double u = 1.0 - t; return 1.0 - u*u*u; }
+            case Type::EaseInOut: return t<0.5 ? 4*t*t*t : 1.0 - std::pow(-2*t+2,3)/2.0;
+            case Type::EaseInBounce : return std::pow( 2, 6 * (t - 1) ) * std::abs( std::sin( t * PI * 3.5 ) );
+            case Type::EaseOutBounce : return 1 - std::pow( 2, -6 * t ) * std::abs( std::cos( t * PI * 3.5 ) );
+            case Type::EaseInElastic: { double t2 = t * t; return t2 * t2 * std::sin( t * PI * 4.5 ); }
+            case Type::EaseOutElastic: { double t2 = (t - 1) * (t - 1);return 1 - t2 * t2 * std::cos( t * PI * 4.5 ); }
+            case Type::EaseInCirc: return 1 - std::sqrt( 1 - t );
+            case Type::EaseOutCirc  : return std::sqrt( t );
+            case Type::EaseInOutCirc: {
+                if( t < 0.5 ) { return (1 - std::sqrt( 1 - 2 * t )) * 0.5; }
+                else { return (1 + std::sqrt( 2 * t - 1 )) * 0.5; }
+            }
+            case Type::EaseInQuint: { double t2 = t * t;return t * t2 * t2;}
+            case Type::EaseOutQuint: {double t2 = (--t) * t;return 1 + t * t2 * t2;}
+            case Type::EaseInOutQuint: {
+                double t2;
+                if( t < 0.5 ) {t2 = t * t;return 16 * t * t2 * t2;}
+                else {t2 = (--t) * t;return 1 + 16 * t * t2 * t2;}
+            }
+            default: return t;
+        }
+    }
+}
+
+#endif // EASING_H
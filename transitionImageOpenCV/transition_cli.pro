@@ -11,7 +11,8 @@ SOURCES += main.cpp \
            transitions.cpp
 
 HEADERS += video_producer.h \
-           transitions.h
+           transitions.h \
+           easing.h
 
 # Chemins d'include (adapter selon ton install)
 INCLUDEPATH += /usr/include/opencv4
@@ -5,7 +5,9 @@ std::unique_ptr<TransitionBetween> createTransitionFromJson(const json& cfg, dou
     double fps = cfg.value("fps", defaultFps>0?defaultFps:30.0);
     std::string type = cfg.value("type", std::string("fade"));
     std::string easingStr = cfg.value("easing", std::string("linear"));
-    Easing::Type easing = Easing::parse(easingStr);
+    Easing::Type easing = Easing::Type::Linear;
+    if (!Easing::parse(easingStr, easing))
+        throw std::runtime_error("Unknown easing: " + easingStr);
 
     // Optional mask blur
     MaskBlurOptions mblur{};
@@ -152,6 +154,7 @@ std::list<std::string> TransitionBetween::getTransitiontring() {
 
 std::list<std::string> TransitionBetween::getEasing() {
   return {
+  "linear" ,
   "ease-in" ,
   "ease-out",
   "ease-in-out" ,
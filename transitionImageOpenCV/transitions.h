@@ -14,11 +14,9 @@
 #include <cmath>
 #include <stdexcept>
 
-using json = nlohmann::json;
+#include "easing.h"
 
-#ifndef PI
-#define PI 3.1415926545
-#endif
+using json = nlohmann::json;
 
 // -------------------- Global mask blur options --------------------
 struct MaskBlurOptions {
@@ -29,61 +27,6 @@ struct MaskBlurOptions {
     bool enabled() const { return ksize > 0 && type != "none"; }
 };
 
-// -------------------- Utility: Easing --------------------
-namespace Easing {
-    enum class Type { Linear, EaseIn, EaseOut, EaseInOut, EaseInBounce,
-                      EaseOutBounce, EaseInElastic, EaseOutElastic,
-                      EaseInCirc, EaseOutCirc, EaseInOutCirc,
-                      EaseInQuint, EaseOutQuint, EaseInOutQuint
-    };
-
-    inline Type parse(const std::string& sIn) {
-        std::string s = sIn;
-        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-        if (s == "ease-in" || s == "easein") return Type::EaseIn;
-        if (s == "ease-out" || s == "easeout") return Type::EaseOut;
-        if (s == "ease-in-out" || s == "easeinout") return Type::EaseInOut;
-        if (s == "ease-in-bounce" || s == "easeinbounce") return Type::EaseInBounce;
-        if (s == "ease-out-bounce" || s == "easeoutbounce") return Type::EaseOutBounce;
-        if (s == "ease-in-elastic" || s == "easeinelastic") return Type::EaseInElastic;
-        if (s == "ease-out-elastic" || s == "easeoutelastic") return Type::EaseOutElastic;
-        if (s == "ease-in-circ" || s == "easeincirc") return Type::EaseInCirc;
-        if (s == "ease-out-circ" || s == "easeoutcirc") return Type::EaseOutCirc;
-        if (s == "ease-inout-circ" || s == "easeinoutcirc") return Type::EaseInOutCirc;
-        if (s == "ease-in-quint" || s == "easeinquint") return Type::EaseInQuint;
-        if (s == "ease-out-quint" || s == "easeoutquint") return Type::EaseOutQuint;
-        if (s == "ease-inout-quint" || s == "easeinoutquint") return Type::EaseInOutQuint;
-        return Type::Linear;
-    }
-
-    inline double apply(double t, Type type) {
-        t = std::clamp(t, 0.0, 1.0);
-        switch(type) {
-            case Type::EaseIn:    return t*t*t;
-            case Type::EaseOut:   { double u = 1.0 - t; return 1.0 - u*u*u; }
-            case Type::EaseInOut: return t<0.5 ? 4*t*t*t : 1.0 - std::pow(-2*t+2,3)/2.0;
-            case Type::EaseInBounce : return std::pow( 2, 6 * (t - 1) ) * std::abs( std::sin( t * PI * 3.5 ) );
-            case Type::EaseOutBounce : return 1 - std::pow( 2, -6 * t ) * std::abs( std::cos( t * PI * 3.5 ) );
-            case Type::EaseInElastic: { double t2 = t * t; return t2 * t2 * std::sin( t * PI * 4.5 ); }
-            case Type::EaseOutElastic: { double t2 = (t - 1) * (t - 1);return 1 - t2 * t2 * std::cos( t * PI * 4.5 ); }
-            case Type::EaseInCirc: return 1 - std::sqrt( 1 - t );
-            case Type::EaseOutCirc  : return std::sqrt( t );
-            case Type::EaseInOutCirc: {
-                if( t < 0.5 ) { return (1 - std::sqrt( 1 - 2 * t )) * 0.5; }
-                else { return (1 + std::sqrt( 2 * t - 1 )) * 0.5; }
-            }
-            case Type::EaseInQuint: { double t2 = t * t;return t * t2 * t2;}
-            case Type::EaseOutQuint: {double t2 = (--t) * t;return 1 + t * t2 * t2;}
-            case Type::EaseInOutQuint: {
-                double t2;
-                if( t < 0.5 ) {t2 = t * t;return 16 * t * t2 * t2;}
-                else {t2 = (--t) * t;return 1 + 16 * t * t2 * t2;}
-            }
-            default: return t;
-        }
-    }
-}
-
 // -------------------- Utility: Blend --------------------
 namespace Blend {
     enum class Mode { Normal, Add, Screen };
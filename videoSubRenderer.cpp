@@ -16,6 +16,7 @@
 // ---- JSON (header-only: nlohmann/json) ----
 // https://github.com/nlohmann/json (single header: json.hpp)
 #include "json.hpp"
+#include "media_probe.h"
 using json = nlohmann::json;
 
 
@@ -304,7 +305,12 @@ int main(int argc, char** argv)
     const int width  = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH);
     const int height = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
     double fps = cap.get(cv::CAP_PROP_FPS);
+    const probe::MediaInfo info = probe::probe(opt.inVideo); // nombre de frames exact
+    if (info.fps > 0.0) fps = info.fps;
     if (fps <= 0.0) { fps = 25.0; std::cerr<<"Avertissement: FPS non disponible, utilisation de 25 fps.\n"; }
+    const long long frameCount = info.frameCount;
+    std::cout<<"Vidéo: "<<width<<"x"<<height<<" @ "<<fps<<" fps, "<<frameCount<<" frames"
+             <<(info.exact ? "" : " (estimation)")<<"\n";
 
     cv::VideoWriter writer(opt.outVideo, cv::VideoWriter::fourcc('m','p','4','v'), fps, cv::Size(width, height));
     if (!writer.isOpened()) { std::cerr<<"Impossible de créer la vidéo de sortie: "<<opt.outVideo<<"\n"; return 1; }
@@ -562,9 +568,10 @@ int main(int argc, char** argv)
 
         writer.write(frame);
         frameIndex++;
+        if (frameIndex % 30 == 0) std::cout<<"Frame "<<frameIndex<<"/"<<frameCount<<"\r"<<std::flush;
     }
 
-    std::cout << "Terminé : " << opt.outVideo << std::endl;
+    std::cout << "\nTerminé : " << opt.outVideo << std::endl;
     return 0;
 }
 